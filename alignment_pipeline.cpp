@@ -0,0 +1,298 @@
+#include "alignment_pipeline.h"
+#include "paf_store.h"
+#include "preprocess.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace{
+    // FASTA text waiting to be aligned; the scan blocks once this much is queued
+    const size_t max_queued_bytes {size_t{128} << 20};
+    // bases per minibatch of minimap2 (-K), so alignment starts long before the scan has found every unitig (minimap2 reads
+    // 500M bases before it maps any by default)
+    const char* executable_batch {"50M"};
+
+    bool write_all(int fd, const char* data, size_t size){
+        while (size > 0){
+            ssize_t written {write(fd, data, size)};
+            if (written < 0){
+                if (errno == EINTR){
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+}
+
+AlignmentPipeline::AlignmentPipeline() : args(), index_path(), paf_path(), filtered_paf_path(), num_threads(1), min_mapq(0), mutex(), changed(),
+    queue(), queued_bytes(0), input_done(false), failed(false), feeder(), reader(), child(-1), out_paf(), out_filtered_paf(), num_unitigs(0){}
+
+AlignmentPipeline::~AlignmentPipeline(){
+    stop();
+}
+
+bool AlignmentPipeline::start(ArgumentParser& user_args){
+    // the feeder thread reads its own copy of the arguments, since looking up a missing one would modify them
+    args.reset(new ArgumentParser(user_args));
+    index_path = preprocess::reference_index_path(*args);
+    paf_path = args->args["-o"] + "/intermediate_output/tumor_only_unitigs.paf";
+    filtered_paf_path = args->args["-o"] + "/intermediate_output/tumor_only_unitigs_mapq_filtered.paf";
+    num_threads = std::max(static_cast<unsigned>(std::stoul(args->args["-t"])), 1u);
+    min_mapq = std::stoll(args->args["--min-mapq"]);
+
+    out_paf.open(paf_path);
+    out_filtered_paf.open(filtered_paf_path);
+    if (!out_paf || !out_filtered_paf){
+        std::cout << "[AlignmentPipeline::start][ERROR] could not open alignment files in " << args->args["-o"] << "/intermediate_output/\n";
+        return false;
+    }
+    // a minimap2 process that exits early makes writes to its input fail instead of ending colorSV
+    std::signal(SIGPIPE, SIG_IGN);
+    feeder = std::thread(&AlignmentPipeline::feed, this);
+    return true;
+}
+
+void AlignmentPipeline::add(std::string&& fasta){
+    if (fasta.empty()){
+        return;
+    }
+    num_unitigs += static_cast<uint64_t>(std::count(fasta.begin(), fasta.end(), '>'));
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&](){
+        return queued_bytes < max_queued_bytes || failed;
+    });
+    // after a failure the records are dropped, and finish reports the error
+    if (failed){
+        return;
+    }
+    queued_bytes += fasta.size();
+    queue.push_back(std::move(fasta));
+    changed.notify_all();
+}
+
+/* Waits for the feeder to align everything that was queued; minimap2 exits once its input is closed */
+bool AlignmentPipeline::finish(StageMetrics& metrics){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        input_done = true;
+        changed.notify_all();
+    }
+    if (feeder.joinable()){
+        feeder.join();
+    }
+    if (reader.joinable()){
+        reader.join();
+    }
+
+    bool ok {!failed};
+    if (child > 0){
+        int status {0};
+        pid_t done;
+        while ((done = waitpid(child, &status, 0)) < 0 && errno == EINTR){}
+        if (done != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0){
+            std::cout << "[AlignmentPipeline::finish][ERROR] minimap2 did not finish aligning the tumor-only unitigs\n";
+            ok = false;
+        }
+        child = -1;
+    }
+    out_paf.close();
+    out_filtered_paf.close();
+    if (!out_paf || !out_filtered_paf){
+        std::cout << "[AlignmentPipeline::finish][ERROR] could not write alignment files in " << args->args["-o"] << "/intermediate_output/\n";
+        ok = false;
+    }
+    if (!ok){
+        return false;
+    }
+
+    metrics.bytes_read = run_metrics::file_size(index_path);
+    metrics.add_count("unitigs", num_unitigs);
+    metrics.add_count("alignments", run_metrics::count_lines(paf_path));
+    metrics.add_count("mapq_filtered_alignments", run_metrics::count_lines(filtered_paf_path));
+    return true;
+}
+
+/* Starts minimap2 on the index as soon as it exists, so it loads the index while the graph is scanned, then writes the
+   queued records to its input while a reader thread filters its output */
+void AlignmentPipeline::feed(){
+    if (!preprocess::index_reference(*args, index_path)){
+        fail();
+        return;
+    }
+
+    std::vector<std::string> command {preprocess::minimap2_executable(*args), "-cx", "lr:hq", "-t" + std::to_string(num_threads), "--ds", "-K", executable_batch, index_path, "-"};
+    std::vector<char*> command_argv;
+    for (auto it = command.begin(); it != command.end(); it++){
+        command_argv.push_back(const_cast<char*>(it->c_str()));
+    }
+    command_argv.push_back(nullptr);
+
+    // the pipe ends are closed on exec, so other programs started by colorSV do not keep minimap2's input open
+    int to_child[2];
+    int from_child[2];
+    if (pipe(to_child) != 0){
+        std::cout << "[AlignmentPipeline::feed][ERROR] could not create a pipe to minimap2\n";
+        fail();
+        return;
+    }
+    if (pipe(from_child) != 0){
+        std::cout << "[AlignmentPipeline::feed][ERROR] could not create a pipe from minimap2\n";
+        close(to_child[0]);
+        close(to_child[1]);
+        fail();
+        return;
+    }
+    for (int fd : {to_child[0], to_child[1], from_child[0], from_child[1]}){
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    pid_t pid {fork()};
+    if (pid == 0){
+        dup2(to_child[0], STDIN_FILENO);
+        dup2(from_child[1], STDOUT_FILENO);
+        execvp(command_argv[0], command_argv.data());
+        _exit(127);
+    }
+    close(to_child[0]);
+    close(from_child[1]);
+    if (pid < 0){
+        std::cout << "[AlignmentPipeline::feed][ERROR] could not start minimap2\n";
+        close(to_child[1]);
+        close(from_child[0]);
+        fail();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        child = pid;
+    }
+    reader = std::thread(&AlignmentPipeline::read_alignments, this, from_child[0]);
+
+    std::string fasta;
+    while (next_input(fasta)){
+        if (!write_all(to_child[1], fasta.data(), fasta.size())){
+            std::cout << "[AlignmentPipeline::feed][ERROR] minimap2 stopped reading the tumor-only unitigs\n";
+            fail();
+            break;
+        }
+    }
+    close(to_child[1]);
+}
+
+bool AlignmentPipeline::next_input(std::string& fasta){
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&](){
+        return !queue.empty() || input_done || failed;
+    });
+    if (failed || queue.empty()){
+        return false;
+    }
+    fasta.swap(queue.front());
+    queue.pop_front();
+    queued_bytes -= fasta.size();
+    changed.notify_all();
+    return true;
+}
+
+/* Splits minimap2's output into lines as it arrives */
+void AlignmentPipeline::read_alignments(int fd){
+    std::vector<char> buffer(size_t{1} << 20);
+    std::string partial;
+    while (true){
+        ssize_t size {read(fd, buffer.data(), buffer.size())};
+        if (size < 0 && errno == EINTR){
+            continue;
+        }
+        if (size <= 0){
+            break;
+        }
+        const char* p {buffer.data()};
+        const char* end {p + size};
+        while (p < end){
+            const char* line_end {static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)))};
+            if (line_end == nullptr){
+                partial.append(p, end);
+                break;
+            }
+            if (partial.empty()){
+                write_alignment(p, static_cast<size_t>(line_end - p));
+            }else{
+                partial.append(p, line_end);
+                write_alignment(partial.data(), partial.size());
+                partial.clear();
+            }
+            p = line_end + 1;
+        }
+    }
+    if (!partial.empty()){
+        write_alignment(partial.data(), partial.size());
+    }
+    close(fd);
+}
+
+void AlignmentPipeline::write_alignment(const char* line, size_t size){
+    out_paf.write(line, static_cast<std::streamsize>(size)).put('\n');
+    // MAPQ is the 12th column
+    const char* p {line};
+    const char* end {line + size};
+    for (int column{0}; column < 11 && p != nullptr; column++){
+        p = static_cast<const char*>(std::memchr(p, '\t', static_cast<size_t>(end - p)));
+        if (p != nullptr){
+            p++;
+        }
+    }
+    if (p == nullptr){
+        return;
+    }
+    const char* mapq_end {static_cast<const char*>(std::memchr(p, '\t', static_cast<size_t>(end - p)))};
+    TextSpan mapq {p, static_cast<size_t>((mapq_end == nullptr ? end : mapq_end) - p)};
+    if (paf_store::parse_int(mapq) >= min_mapq){
+        out_filtered_paf.write(line, static_cast<std::streamsize>(size)).put('\n');
+    }
+}
+
+void AlignmentPipeline::fail(){
+    std::lock_guard<std::mutex> lock(mutex);
+    failed = true;
+    queue.clear();
+    queued_bytes = 0;
+    changed.notify_all();
+}
+
+// stops a pipeline that was not finished, e.g. after the scan failed, without waiting for the remaining alignments
+void AlignmentPipeline::stop(){
+    if (!feeder.joinable()){
+        return;
+    }
+    fail();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (child > 0){
+            kill(child, SIGTERM);
+        }
+    }
+    feeder.join();
+    // minimap2 may have started after the check above
+    if (child > 0){
+        kill(child, SIGTERM);
+    }
+    if (reader.joinable()){
+        reader.join();
+    }
+    if (child > 0){
+        int status;
+        while (waitpid(child, &status, 0) < 0 && errno == EINTR){}
+        child = -1;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef ALIGNMENT_PIPELINE_H
+#define ALIGNMENT_PIPELINE_H
+
+#include "argument_parser.h"
+#include "run_metrics.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+
+// Aligns tumor-only unitigs while the graph is still being scanned: the reference index loads in the background as soon as
+// the pipeline starts, the scan queues the FASTA records of the unitigs it keeps, and alignments are MAPQ-filtered as they
+// are produced; the alignment files are the same as those of preprocess::align_unitigs
+class AlignmentPipeline{
+	public:
+		AlignmentPipeline();
+		~AlignmentPipeline();
+		AlignmentPipeline(const AlignmentPipeline&) = delete;
+		AlignmentPipeline& operator=(const AlignmentPipeline&) = delete;
+
+		bool start(ArgumentParser& user_args);
+		// queues whole FASTA records, in file order; blocks while the queue is full, so the scan waits for alignment to catch up
+		void add(std::string&& fasta);
+		// waits until every queued unitig is aligned and the alignment files are written
+		bool finish(StageMetrics& metrics);
+
+	private:
+		void feed();
+		// pops the next FASTA records into fasta; false once the input is done and the queue is empty
+		bool next_input(std::string& fasta);
+		void read_alignments(int fd);
+		void write_alignment(const char* line, size_t size);
+		void fail();
+		void stop();
+
+		std::unique_ptr<ArgumentParser> args;
+		std::string index_path;
+		std::string paf_path;
+		std::string filtered_paf_path;
+		unsigned num_threads;
+		int64_t min_mapq;
+
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::deque<std::string> queue;
+		size_t queued_bytes;
+		bool input_done;
+		bool failed;
+
+		std::thread feeder;
+		std::thread reader;
+		pid_t child;
+		std::ofstream out_paf;
+		std::ofstream out_filtered_paf;
+		uint64_t num_unitigs;
+};
+
+#endif
@@ -11,7 +11,7 @@ ArgumentParser::ArgumentParser(int &argc, char** argv){
         this->args.insert({"command", "--help"});
     }
     // first argument should indicate valid command; otherwise throw error
-    else if(std::strcmp(*(argv + 1), "preprocess") && std::strcmp(*(argv + 1), "call") && std::strcmp(*(argv + 1), "--help") && std::strcmp(*(argv + 1), "sv")){
+    else if(std::strcmp(*(argv + 1), "preprocess") && std::strcmp(*(argv + 1), "call") && std::strcmp(*(argv + 1), "run") && std::strcmp(*(argv + 1), "batch") && std::strcmp(*(argv + 1), "merge") && std::strcmp(*(argv + 1), "--help") && std::strcmp(*(argv + 1), "sv")){
         throw std::invalid_argument("Command not found, see colorSV --help for valid commands");
     }else {
         std::string executable {*(argv)};
@@ -69,16 +69,21 @@ bool ArgumentParser::check_required_flags(std::list<std::string>& r_flags){
     return true;
 }
 
-bool ArgumentParser::check_file(std::string opt, std::string ext){
+bool ArgumentParser::check_file(std::string opt, std::string ext, bool allow_gzip){
     struct stat buffer;   
     if (stat(this->args[opt].c_str(), &buffer) != 0){
         std::cout << "[ArgumentParser::check_file][ERROR] file specified in " << opt << " is not readable\n";
         return false;
     }
 
-    size_t del_pos {this->args[opt].find_last_of('.')};
-    if (del_pos == std::string::npos || this->args[opt].substr(del_pos) != ext){
-        std::cout << "[ArgumentParser::check_file][ERROR] file specified in " << opt << " must be type " << ext << '\n';
+    // gzip-compressed files keep the extension of the uncompressed file before .gz
+    std::string path {this->args[opt]};
+    if (allow_gzip && path.size() > 3 && path.substr(path.size() - 3) == ".gz"){
+        path.erase(path.size() - 3);
+    }
+    size_t del_pos {path.find_last_of('.')};
+    if (del_pos == std::string::npos || path.substr(del_pos) != ext){
+        std::cout << "[ArgumentParser::check_file][ERROR] file specified in " << opt << " must be type " << ext << (allow_gzip ? " or " + ext + ".gz" : "") << '\n';
         return false;
     }
 
@@ -90,21 +95,49 @@ void print_help(){
     std::cout << "Commands and options:\n";
     std::cout << "  * preprocess\n";
     std::cout << "     <required flags>\n";
-    std::cout << "          --graph             STR     path to assembly graph file\n";
+    std::cout << "          --graph             STR     path to assembly graph file (.gfa or .gfa.gz)\n";
     std::cout << "          --reference         STR     path to reference genome file\n";
     std::cout << "          --tumor-ids         STR     tumor sample identifiers\n";
     std::cout << "          --read-sep          STR     delimiter in read names (e.g., / or .)\n";
     std::cout << "     [optional flags] \n";
     std::cout << "          --min-reads         INT     minimum number of reads when identifying tumor-only unitigs [2]\n";
     std::cout << "          --min-mapq          INT     minimum MAPQ required for tumor-only unitig alignments [10]\n";
-    std::cout << "          -t                  INT     number of threads during alignment [3]\n";
+    std::cout << "          --motif-file        STR     file of repeat motifs to screen tumor-only unitigs for [telomere repeat]\n";
+    std::cout << "          --max-motif-density FLOAT   maximum motif hits per kb in a tumor-only unitig [0]\n";
+    std::cout << "          --reference-index   STR     minimap2 index of the reference, built if missing [<reference>.lr_hq.mmi]\n";
+    std::cout << "          --pipeline          STR     align tumor-only unitigs while the graph is scanned, yes or no [yes]\n";
+    std::cout << "          --support-table     STR     read support of every unitig, written when the graph is scanned [intermediate_output/unitig_support.bin]\n";
+    std::cout << "          --from-support-table STR    pick tumor-only unitigs from --support-table instead of scanning the graph, yes or no [no]\n";
+    std::cout << "          -t                  INT     number of threads during graph scanning and alignment [3]\n";
     std::cout << "  * call\n";
     std::cout << "     <required flags>\n";
-    std::cout << "          --graph             STR     path to assembly graph file\n";
+    std::cout << "          --graph             STR     path to assembly graph file (.gfa or .gfa.gz)\n";
     std::cout << "          --filter            STR     path to BED file with regions to ignore (e.g., centromeres)\n";
     std::cout << "     [optional flags] \n";
-    std::cout << "          -k                  INT     maximum number of steps in topology search [10]\n";
+    std::cout << "          -k                  INT     maximum number of steps in topology search, or a comma separated list [10]\n";
     std::cout << "          -q                  INT     minimum MAPQ of alignments when extracting breakpoints [15]\n";
     std::cout << "          -Q                  INT     minimum MAPQ for alignment ends when extracting breakpoints [15]\n";
-    std::cout << "          --index-bin-size    INT     unitigs per bin when indexing assembly graph file [100]\n";
+    std::cout << "          -t                  INT     number of threads during topology search and SV extraction [3]\n";
+    std::cout << "          --search            STR     topology search mode, single or bidirectional [single]\n";
+    std::cout << "          --component-prepass STR     keep candidates that disconnect their neighbors without a search, yes or no [no]\n";
+    std::cout << "          --compress          STR     compression of the call sets, none or bgzf [none]\n";
+    std::cout << "          --prune-masked      STR     skip candidates with all alignments in --filter regions, yes or no [no]\n";
+    std::cout << "          --link-memory       INT     MB of links held in memory while building the graph cache, 0 for no limit [0]\n";
+    std::cout << "          --shard             STR     only search shard i of N of the candidates and save its results for merge (e.g., 2/8)\n";
+    std::cout << "  * merge\n";
+    std::cout << "     combine the results of the shards of a call into its candidate alignments and call sets; takes the -k and SV extraction flags of call\n";
+    std::cout << "     <required flags>\n";
+    std::cout << "          --shards            INT     number of shards the call was split into\n";
+    std::cout << "          --filter            STR     path to BED file with regions to ignore (e.g., centromeres)\n";
+    std::cout << "  * run\n";
+    std::cout << "     preprocess and call in one pass over the graph; takes the required flags of both commands and any of their optional flags\n";
+    std::cout << "  * batch\n";
+    std::cout << "     run for every tumor-normal pair of a manifest; takes the optional flags of run for all pairs\n";
+    std::cout << "     <required flags>\n";
+    std::cout << "          --manifest          STR     tab-separated graph, tumor IDs, read separator and output directory of each pair\n";
+    std::cout << "          --reference         STR     path to reference genome file\n";
+    std::cout << "          --filter            STR     path to BED file with regions to ignore (e.g., centromeres)\n";
+    std::cout << "     [optional flags] \n";
+    std::cout << "          -t                  INT     number of threads shared by all pairs [all hardware threads]\n";
+    std::cout << "          --jobs              INT     maximum number of pairs run at the same time [threads / 4]\n";
 }
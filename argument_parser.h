@@ -8,7 +8,7 @@
 class ArgumentParser{
 	public:
 		ArgumentParser(int &argc, char**argv);
-		bool check_file(std::string opt, std::string ext);
+		bool check_file(std::string opt, std::string ext, bool allow_gzip = false);
 		bool check_required_flags(std::list<std::string>& r_flags);
 
 		std::map<std::string, std::string> args;
@@ -0,0 +1,233 @@
+#include "batch.h"
+#include "preprocess.h"
+#include "run_metrics.h"
+#include "topology_search.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <set>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace{
+    struct RunningEntry{
+        pid_t pid;
+        size_t entry;
+        unsigned threads;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // runs in the child process of an entry; the entry's messages go to its output directory instead of mixing with those of
+    // the other entries
+    int run_entry_process(ArgumentParser& args, const std::function<bool(ArgumentParser&)>& run_entry){
+        preprocess::file_setup(args);
+        std::string log_path {args.args["-o"] + "/colorSV.log"};
+        int log_fd {open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)};
+        if (log_fd >= 0){
+            dup2(log_fd, STDOUT_FILENO);
+            close(log_fd);
+        }
+        bool ok {run_entry(args)};
+        std::cout.flush();
+        return ok ? 0 : 1;
+    }
+}
+
+/* Checks that the user input all required flags */
+bool batch::check_args(ArgumentParser& user_args){
+    std::list<std::string> required {"--manifest", "--reference", "--filter"};
+    if (!user_args.check_required_flags(required)){
+        return false;
+    }
+
+    // the thread budget is shared by all entries that run at the same time
+    if (user_args.args.count("-t") == 0){
+        user_args.args.insert({"-t", std::to_string(std::max(std::thread::hardware_concurrency(), 1u))});
+    }
+    if (std::stoi(user_args.args["-t"]) < 1){
+        std::cout << "[batch::check_args][ERROR] number of threads must be at least 1\n";
+        return false;
+    }
+
+    if (user_args.args.count("--jobs") == 0){
+        user_args.args.insert({"--jobs", std::to_string(std::max(std::stoi(user_args.args["-t"]) / 4, 1))});
+    }
+    if (std::stoi(user_args.args["--jobs"]) < 1){
+        std::cout << "[batch::check_args][ERROR] number of jobs must be at least 1\n";
+        return false;
+    }
+
+    struct stat buffer;
+    if (stat(user_args.args["--manifest"].c_str(), &buffer) != 0){
+        std::cout << "[batch::check_args][ERROR] could not open manifest file: " << user_args.args["--manifest"] << '\n';
+        return false;
+    }
+    return true;
+}
+
+/* Reads the tab-separated graph, tumor IDs, read separator and output directory of every entry; empty lines and lines
+   starting with # are skipped */
+bool batch::read_manifest(const std::string& manifest_path, std::vector<BatchEntry>& entries){
+    std::ifstream manifest(manifest_path);
+    if (!manifest){
+        std::cout << "[batch::read_manifest][ERROR] could not open manifest file: " << manifest_path << '\n';
+        return false;
+    }
+    std::set<std::string> output_dirs;
+    std::string line;
+    size_t line_number {0};
+    while (std::getline(manifest, line)){
+        line_number++;
+        if (!line.empty() && line.back() == '\r'){
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#'){
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        size_t start {0};
+        size_t end;
+        while ((end = line.find('\t', start)) != std::string::npos){
+            fields.push_back(line.substr(start, end - start));
+            start = end + 1;
+        }
+        fields.push_back(line.substr(start));
+        if (fields.size() != 4 || std::find(fields.begin(), fields.end(), "") != fields.end()){
+            std::cout << "[batch::read_manifest][ERROR] line " << line_number << " of " << manifest_path << " does not have 4 tab-separated fields (graph, tumor IDs, read separator, output directory)\n";
+            return false;
+        }
+        // entries writing to the same directory would overwrite each other's output
+        if (!output_dirs.insert(fields[3]).second){
+            std::cout << "[batch::read_manifest][ERROR] output directory " << fields[3] << " is used by more than one entry\n";
+            return false;
+        }
+
+        BatchEntry entry;
+        entry.graph = fields[0];
+        entry.tumor_ids = fields[1];
+        entry.read_sep = fields[2];
+        entry.output_dir = fields[3];
+        entry.graph_size = run_metrics::file_size(entry.graph);
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+/* Runs preprocess and call for every entry of the manifest. The reference index is built or loaded once before any entry
+   starts, and the entries run in their own processes, at most --jobs at a time, splitting the -t threads between them.
+   Entries with the largest graphs start first, so the long entries overlap with each other rather than with the end of the
+   batch, and the small entries at the end fill the threads the large ones free up */
+bool batch::run_batch(ArgumentParser& user_args, const std::function<bool(ArgumentParser&)>& run_entry){
+    std::vector<BatchEntry> entries;
+    if (!read_manifest(user_args.args["--manifest"], entries)){
+        return false;
+    }
+    if (entries.empty()){
+        std::cout << "[batch::run_batch][ERROR] manifest has no entries: " << user_args.args["--manifest"] << '\n';
+        return false;
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const BatchEntry& a, const BatchEntry& b){
+        return a.graph_size > b.graph_size;
+    });
+    unsigned num_threads {static_cast<unsigned>(std::stoul(user_args.args["-t"]))};
+    unsigned max_jobs {std::min({static_cast<unsigned>(std::stoul(user_args.args["--jobs"])), num_threads, static_cast<unsigned>(entries.size())})};
+
+    // each entry runs the run command with the flags of the batch
+    std::vector<ArgumentParser> entry_args(entries.size(), user_args);
+    for (size_t i{0}; i < entries.size(); i++){
+        ArgumentParser& args {entry_args[i]};
+        args.args.erase("--manifest");
+        args.args.erase("--jobs");
+        args.args["command"] = "run";
+        args.args["--graph"] = entries[i].graph;
+        args.args["--tumor-ids"] = entries[i].tumor_ids;
+        args.args["--read-sep"] = entries[i].read_sep;
+        args.args["-o"] = entries[i].output_dir;
+        if (!preprocess::check_args(args) || !topology_search::check_args(args)){
+            std::cout << "[batch::run_batch][ERROR] invalid manifest entry for output directory " << entries[i].output_dir << '\n';
+            return false;
+        }
+    }
+
+    // the index is built here so that the entries do not each build it at the same time
+    preprocess::file_setup(entry_args[0]);
+    std::string index_path {preprocess::reference_index_path(entry_args[0])};
+    if (!preprocess::index_reference(entry_args[0], index_path)){
+        return false;
+    }
+    for (auto it = entry_args.begin(); it != entry_args.end(); it++){
+        it->args["--reference-index"] = index_path;
+    }
+
+    std::cout << "[batch] running " << entries.size() << " entries with " << num_threads << " threads, at most " << max_jobs << " at a time\n";
+    auto batch_start = std::chrono::steady_clock::now();
+    std::vector<RunningEntry> running;
+    size_t next_entry {0};
+    size_t num_failed {0};
+    unsigned free_threads {num_threads};
+    while (next_entry < entries.size() || !running.empty()){
+        while (next_entry < entries.size() && running.size() < max_jobs){
+            // the free threads are split evenly between the entries that start now, with any remainder going to the larger ones
+            unsigned open_slots {static_cast<unsigned>(std::min(size_t{max_jobs} - running.size(), entries.size() - next_entry))};
+            unsigned threads {std::max((free_threads + open_slots - 1) / open_slots, 1u)};
+            ArgumentParser& args {entry_args[next_entry]};
+            args.args["-t"] = std::to_string(threads);
+            std::cout << "[batch] starting " << entries[next_entry].output_dir << " (" << static_cast<double>(entries[next_entry].graph_size) / (1024 * 1024) << " MB graph, " << threads << " threads)\n";
+            std::cout.flush();
+
+            pid_t pid {fork()};
+            if (pid == 0){
+                _exit(run_entry_process(args, run_entry));
+            }
+            if (pid < 0){
+                std::cout << "[batch::run_batch][ERROR] could not start a process for " << entries[next_entry].output_dir << '\n';
+                num_failed++;
+            }else{
+                running.push_back({pid, next_entry, threads, std::chrono::steady_clock::now()});
+                free_threads -= threads;
+            }
+            next_entry++;
+        }
+        if (running.empty()){
+            continue;
+        }
+
+        int status;
+        pid_t done {waitpid(-1, &status, 0)};
+        if (done < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            std::cout << "[batch::run_batch][ERROR] lost track of the running entries\n";
+            return false;
+        }
+        auto finished = std::find_if(running.begin(), running.end(), [done](const RunningEntry& entry){
+            return entry.pid == done;
+        });
+        if (finished == running.end()){
+            continue;
+        }
+        std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - finished->start};
+        const std::string& output_dir {entries[finished->entry].output_dir};
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0){
+            std::cout << "[batch] finished " << output_dir << " in " << elapsed.count() << " s\n";
+        }else{
+            std::cout << "[batch][ERROR] " << output_dir << " failed after " << elapsed.count() << " s, see " << output_dir << "/colorSV.log\n";
+            num_failed++;
+        }
+        free_threads += finished->threads;
+        running.erase(finished);
+    }
+
+    std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - batch_start};
+    std::cout << "[batch] " << entries.size() - num_failed << " of " << entries.size() << " entries finished in " << elapsed.count() << " s\n";
+    return num_failed == 0;
+}
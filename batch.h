@@ -0,0 +1,28 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "argument_parser.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// One tumor-normal pair of a batch manifest; the other flags of the batch command apply to every entry
+struct BatchEntry{
+	BatchEntry() : graph(), tumor_ids(), read_sep(), output_dir(), graph_size(0){}
+	std::string graph;
+	std::string tumor_ids;
+	std::string read_sep;
+	std::string output_dir;
+	uint64_t graph_size;
+};
+
+namespace batch{
+	bool check_args(ArgumentParser& user_args);
+	bool read_manifest(const std::string& manifest_path, std::vector<BatchEntry>& entries);
+	// runs run_entry on the run command arguments of every entry, each in its own process
+	bool run_batch(ArgumentParser& user_args, const std::function<bool(ArgumentParser&)>& run_entry);
+}
+
+#endif
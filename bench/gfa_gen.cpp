@@ -0,0 +1,126 @@
+// Writes a synthetic co-assembly graph for testing and benchmarking, and the names of its translocation bubbles to <output>.bubbles.txt
+#include "gfa_generator.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace{
+    void print_usage(){
+        GeneratorOptions defaults;
+        std::cout << "usage: bench/gfa_gen -o <graph.gfa> [options]\n"
+                  << "    --nodes <int>            unitigs in the chain [" << defaults.num_nodes << "]\n"
+                  << "    --mean-degree <float>    average number of linked unitigs per unitig [" << defaults.mean_degree << "]\n"
+                  << "    --degree-dist <str>      uniform, geometric or powerlaw [" << defaults.degree_distribution << "]\n"
+                  << "    --far-links <float>      fraction of extra links to random unitigs anywhere in the graph [" << defaults.far_link_fraction << "]\n"
+                  << "    --tumor-fraction <float> fraction of tumor-only unitigs [" << defaults.tumor_fraction << "]\n"
+                  << "    --tumor-ids <str>        comma-separated tumor sample IDs [tum1]\n"
+                  << "    --normal-ids <str>       comma-separated normal sample IDs [nor1,nor2]\n"
+                  << "    --read-sep <char>        separator between sample ID and read number in read names [" << defaults.read_sep << "]\n"
+                  << "    --reads <min,max>        reads per unitig [" << defaults.min_reads << ',' << defaults.max_reads << "]\n"
+                  << "    --length <int>           mean unitig length [" << defaults.segment_length << "]\n"
+                  << "    --bubbles <int>          translocation bubbles [" << defaults.num_bubbles << "]\n"
+                  << "    --seed <int>             random seed [" << defaults.seed << "]\n";
+    }
+
+    std::vector<std::string> split(const std::string& list, char delim){
+        std::vector<std::string> fields;
+        size_t start {0};
+        size_t end;
+        while ((end = list.find(delim, start)) != std::string::npos){
+            fields.push_back(list.substr(start, end - start));
+            start = end + 1;
+        }
+        fields.push_back(list.substr(start));
+        return fields;
+    }
+
+    bool set_option(GeneratorOptions& opt, const std::string& flag, const std::string& value){
+        if (flag == "--nodes"){
+            opt.num_nodes = static_cast<uint32_t>(std::stoul(value));
+        }else if (flag == "--mean-degree"){
+            opt.mean_degree = std::stod(value);
+        }else if (flag == "--degree-dist"){
+            if (value != "uniform" && value != "geometric" && value != "powerlaw"){
+                return false;
+            }
+            opt.degree_distribution = value;
+        }else if (flag == "--far-links"){
+            opt.far_link_fraction = std::stod(value);
+        }else if (flag == "--tumor-fraction"){
+            opt.tumor_fraction = std::stod(value);
+        }else if (flag == "--tumor-ids"){
+            opt.tumor_ids = split(value, ',');
+        }else if (flag == "--normal-ids"){
+            opt.normal_ids = split(value, ',');
+        }else if (flag == "--read-sep"){
+            if (value.size() != 1){
+                return false;
+            }
+            opt.read_sep = value[0];
+        }else if (flag == "--reads"){
+            std::vector<std::string> range {split(value, ',')};
+            if (range.size() != 2){
+                return false;
+            }
+            opt.min_reads = static_cast<uint32_t>(std::stoul(range[0]));
+            opt.max_reads = static_cast<uint32_t>(std::stoul(range[1]));
+        }else if (flag == "--length"){
+            opt.segment_length = static_cast<uint32_t>(std::stoul(value));
+        }else if (flag == "--bubbles"){
+            opt.num_bubbles = static_cast<uint32_t>(std::stoul(value));
+        }else if (flag == "--seed"){
+            opt.seed = std::stoull(value);
+        }else{
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv){
+    GeneratorOptions opt;
+    std::string output;
+    for (int i{1}; i < argc; i += 2){
+        std::string flag {argv[i]};
+        if (flag == "-h" || flag == "--help" || i + 1 == argc){
+            print_usage();
+            return flag == "-h" || flag == "--help" ? 0 : 1;
+        }
+        std::string value {argv[i + 1]};
+        bool valid {true};
+        try{
+            if (flag == "-o"){
+                output = value;
+            }else{
+                valid = set_option(opt, flag, value);
+            }
+        }catch (const std::logic_error&){
+            valid = false;
+        }
+        if (!valid){
+            std::cout << "invalid option: " << flag << ' ' << value << '\n';
+            return 1;
+        }
+    }
+    if (output.empty()){
+        print_usage();
+        return 1;
+    }
+
+    GeneratedGraph graph;
+    if (!gfa_generator::write_gfa(output, opt, graph)){
+        std::cout << "could not write " << output << '\n';
+        return 1;
+    }
+    std::ofstream bubbles(output + ".bubbles.txt");
+    for (auto it = graph.bubble_names.begin(); it != graph.bubble_names.end(); it++){
+        bubbles << *it << '\n';
+    }
+    std::cout << "wrote " << graph.num_segments << " unitigs (" << graph.num_tumor_only << " tumor-only), " << graph.num_links << " links and "
+              << graph.bubble_names.size() << " translocation bubbles to " << output << '\n';
+    return bubbles ? 0 : 1;
+}
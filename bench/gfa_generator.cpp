@@ -0,0 +1,183 @@
+#include "gfa_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <utility>
+
+namespace{
+    // std::mt19937_64 output is fixed by the standard, but the std:: distributions are not, so values are drawn by inversion
+    class Draw{
+        public:
+            explicit Draw(uint64_t seed) : rng(seed){}
+
+            // uniform in [0, 1)
+            double unit(){
+                return static_cast<double>(rng() >> 11) * (1.0 / 9007199254740992.0);
+            }
+
+            // uniform in [0, n)
+            uint64_t below(uint64_t n){
+                return std::min(n - 1, static_cast<uint64_t>(unit() * static_cast<double>(n)));
+            }
+
+            uint64_t between(uint64_t low, uint64_t high){
+                return low + below(high - low + 1);
+            }
+
+            bool chance(double p){
+                return unit() < p;
+            }
+
+            // number of extra links with the given mean
+            uint64_t extra_links(const std::string& distribution, double mean){
+                if (mean <= 0){
+                    return 0;
+                }
+                double value;
+                if (distribution == "uniform"){
+                    value = unit() * (2 * mean + 1);
+                }else if (distribution == "powerlaw"){
+                    // Lomax with shape 2: mean equal to the scale, infinite variance
+                    value = (mean + 0.5) * (1 / std::sqrt(1 - unit()) - 1);
+                }else{
+                    // geometric over 0, 1, 2, ... with the given mean
+                    value = std::log(1 - unit()) / std::log(mean / (mean + 1));
+                }
+                return std::min(static_cast<uint64_t>(value), uint64_t{1000});
+            }
+
+        private:
+            std::mt19937_64 rng;
+    };
+
+    void append_number(std::string& line, uint64_t value){
+        char digits[24];
+        int size {std::snprintf(digits, sizeof(digits), "%llu", static_cast<unsigned long long>(value))};
+        line.append(digits, static_cast<size_t>(size));
+    }
+
+    // S line and the A lines of the unitig's reads, which all come from tumor samples for tumor-only unitigs
+    void append_segment(std::string& out, const std::string& name, bool tumor_only, const GeneratorOptions& opt, Draw& draw, uint64_t& read_count){
+        const char bases[4] {'A', 'C', 'G', 'T'};
+        uint64_t length {draw.between(std::max(opt.segment_length / 2, 1u), opt.segment_length + opt.segment_length / 2)};
+        uint64_t num_reads {draw.between(opt.min_reads, opt.max_reads)};
+
+        out += "S\t";
+        out += name;
+        out += '\t';
+        for (uint64_t i{0}; i < length; i++){
+            out += bases[draw.below(4)];
+        }
+        out += "\tLN:i:";
+        append_number(out, length);
+        out += "\trd:i:";
+        append_number(out, num_reads);
+        out += '\n';
+
+        for (uint64_t i{0}; i < num_reads; i++){
+            // mixed unitigs get at least one normal read
+            bool tumor_read {tumor_only || (i > 0 && draw.chance(0.5))};
+            const std::vector<std::string>& samples {tumor_read ? opt.tumor_ids : opt.normal_ids};
+            out += "A\t";
+            out += name;
+            out += '\t';
+            append_number(out, draw.below(length));
+            out += "\t+\t";
+            out += samples[draw.below(samples.size())];
+            out += opt.read_sep;
+            append_number(out, read_count++);
+            out += opt.read_sep;
+            out += "ccs\t0\t";
+            append_number(out, length);
+            out += "\tid:i:";
+            append_number(out, read_count);
+            out += "\tHG:A:a\n";
+        }
+    }
+}
+
+GeneratorOptions::GeneratorOptions() : num_nodes(100000), mean_degree(3.0), degree_distribution("geometric"), far_link_fraction(0.2), tumor_fraction(0.05),
+    tumor_ids{"tum1"}, normal_ids{"nor1", "nor2"}, read_sep('/'), min_reads(2), max_reads(8), segment_length(200), num_bubbles(100), seed(1){}
+
+GeneratedGraph::GeneratedGraph() : num_segments(0), num_links(0), num_tumor_only(0), bubble_names(){}
+
+std::string gfa_generator::unitig_name(uint32_t id){
+    char name[24];
+    std::snprintf(name, sizeof(name), "utg%06ul", id + 1);
+    return name;
+}
+
+bool gfa_generator::write_gfa(const std::string& path, const GeneratorOptions& opt, GeneratedGraph& graph){
+    if (opt.num_nodes < 2 || opt.tumor_ids.empty() || opt.normal_ids.empty() || opt.min_reads > opt.max_reads){
+        return false;
+    }
+    std::ofstream gfa(path);
+    if (!gfa){
+        return false;
+    }
+    Draw draw(opt.seed);
+    graph = GeneratedGraph();
+    uint32_t num_total {opt.num_nodes + opt.num_bubbles};
+
+    // segments of the chain, then the bubble unitigs
+    std::string out;
+    uint64_t read_count {0};
+    for (uint32_t id{0}; id < num_total; id++){
+        bool bubble {id >= opt.num_nodes};
+        bool tumor_only {bubble || draw.chance(opt.tumor_fraction)};
+        append_segment(out, gfa_generator::unitig_name(id), tumor_only, opt, draw, read_count);
+        graph.num_tumor_only += tumor_only;
+        if (out.size() > (1 << 20)){
+            gfa << out;
+            out.clear();
+        }
+    }
+    graph.num_segments = num_total;
+
+    // chain links, extra links from repeats and bubbles, and the two links of each translocation bubble
+    std::vector<std::pair<uint32_t, uint32_t>> links;
+    double mean_extra {std::max(0.0, (opt.mean_degree - 2) / 2)};
+    for (uint32_t id{0}; id < opt.num_nodes; id++){
+        if (id + 1 < opt.num_nodes){
+            links.push_back({id, id + 1});
+        }
+        for (uint64_t i{draw.extra_links(opt.degree_distribution, mean_extra)}; i > 0; i--){
+            uint32_t other;
+            if (draw.chance(opt.far_link_fraction)){
+                other = static_cast<uint32_t>(draw.below(opt.num_nodes));
+            }else{
+                uint64_t offset {draw.between(2, 50)};
+                other = static_cast<uint32_t>(draw.chance(0.5) ? std::min<uint64_t>(id + offset, opt.num_nodes - 1) : (id >= offset ? id - offset : 0));
+            }
+            if (other != id){
+                links.push_back({id, other});
+            }
+        }
+    }
+    for (uint32_t id{opt.num_nodes}; id < num_total; id++){
+        // the two ends of a translocation are at least a tenth of the chain apart
+        uint32_t left {static_cast<uint32_t>(draw.below(opt.num_nodes))};
+        uint32_t distance {static_cast<uint32_t>(draw.between(std::max(opt.num_nodes / 10, 1u), std::max(opt.num_nodes / 2, 1u)))};
+        uint32_t right {(left + distance) % opt.num_nodes};
+        links.push_back({left, id});
+        links.push_back({id, right});
+        graph.bubble_names.push_back(gfa_generator::unitig_name(id));
+    }
+
+    for (auto it = links.begin(); it != links.end(); it++){
+        std::string source {gfa_generator::unitig_name(it->first)};
+        std::string target {gfa_generator::unitig_name(it->second)};
+        out += "L\t" + source + "\t+\t" + target + "\t+\t0M\tL1:i:0\n";
+        out += "L\t" + target + "\t-\t" + source + "\t-\t0M\tL1:i:0\n";
+        if (out.size() > (1 << 20)){
+            gfa << out;
+            out.clear();
+        }
+    }
+    gfa << out;
+    graph.num_links = links.size() * 2;
+    return static_cast<bool>(gfa);
+}
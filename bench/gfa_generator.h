@@ -0,0 +1,49 @@
+#ifndef GFA_GENERATOR_H
+#define GFA_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Shape of a synthetic hifiasm-style co-assembly graph: a chain of unitigs (the genome) with extra links from repeats and
+// bubbles, S lines followed by the A lines of their reads, and every link written in both directions after all segments
+struct GeneratorOptions{
+	GeneratorOptions();
+
+	uint32_t num_nodes;
+	// average number of linked unitigs per unitig; the chain gives every unitig 2, the rest come from extra links
+	double mean_degree;
+	// distribution of the number of extra links a unitig starts: uniform, geometric or powerlaw
+	std::string degree_distribution;
+	// fraction of extra links that go to a random unitig anywhere in the graph instead of one at most 50 unitigs away
+	double far_link_fraction;
+	// fraction of unitigs whose reads all come from tumor samples
+	double tumor_fraction;
+	std::vector<std::string> tumor_ids;
+	std::vector<std::string> normal_ids;
+	char read_sep;
+	uint32_t min_reads;
+	uint32_t max_reads;
+	// unitig lengths are uniform in [segment_length / 2, segment_length * 3 / 2]
+	uint32_t segment_length;
+	// translocation bubbles: tumor-only unitigs added after the chain that link two unitigs far apart in the chain
+	uint32_t num_bubbles;
+	uint64_t seed;
+};
+
+struct GeneratedGraph{
+	GeneratedGraph();
+
+	uint64_t num_segments;
+	uint64_t num_links;
+	uint64_t num_tumor_only;
+	std::vector<std::string> bubble_names;
+};
+
+namespace gfa_generator{
+	// the same options and seed always give the same file
+	bool write_gfa(const std::string& path, const GeneratorOptions& opt, GeneratedGraph& graph);
+	std::string unitig_name(uint32_t id);
+}
+
+#endif
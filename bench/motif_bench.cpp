@@ -0,0 +1,91 @@
+// Microbenchmark of tumor-only unitig motif screening: std::string::find against the MotifScanner kernels
+#include "../motif_scan.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace{
+    // random unitig sequences, a few of which carry a telomere repeat
+    std::vector<std::string> make_sequences(size_t num_sequences, size_t length, std::mt19937& rng){
+        const char bases[4] {'A', 'C', 'G', 'T'};
+        std::uniform_int_distribution<int> base(0, 3);
+        std::uniform_int_distribution<int> percent(0, 99);
+        std::vector<std::string> sequences(num_sequences);
+        for (auto it = sequences.begin(); it != sequences.end(); it++){
+            it->resize(length);
+            for (auto c = it->begin(); c != it->end(); c++){
+                *c = bases[base(rng)];
+            }
+            if (percent(rng) < 2){
+                it->replace(length / 2, 30, "CCCTAACCCTAACCCTAACCCTAACCCTAA");
+            }
+        }
+        return sequences;
+    }
+
+    template <typename F>
+    double time_mb_per_s(const std::vector<std::string>& sequences, F screen, uint64_t& hits){
+        auto start = std::chrono::steady_clock::now();
+        hits = 0;
+        size_t total {0};
+        for (auto it = sequences.begin(); it != sequences.end(); it++){
+            hits += screen(*it);
+            total += it->size();
+        }
+        std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - start};
+        return static_cast<double>(total) / (1 << 20) / elapsed.count();
+    }
+
+    const char* kernel_name(MotifKernel kernel){
+        switch (kernel){
+            case MotifKernel::avx2: return "avx2";
+            case MotifKernel::sse2: return "sse2";
+            default: return "scalar";
+        }
+    }
+}
+
+int main(){
+    std::mt19937 rng(42);
+    std::vector<std::string> sequences {make_sequences(4000, 20000, rng)};
+
+    // current filter: two exact searches for the telomere repeat
+    const std::string tel_seq_for {"TTAGGGTTAGGGTTAGGGTTAGGGTTAGGG"};
+    const std::string tel_seq_rev {"CCCTAACCCTAACCCTAACCCTAACCCTAA"};
+    uint64_t find_hits;
+    double find_speed {time_mb_per_s(sequences, [&](const std::string& seq){
+        return static_cast<uint64_t>(seq.find(tel_seq_for) != std::string::npos || seq.find(tel_seq_rev) != std::string::npos);
+    }, find_hits)};
+    std::cout << "telomere, std::string::find:    " << find_speed << " MB/s, " << find_hits << " sequences rejected\n";
+
+    MotifScanner telomere;
+    telomere.add_motif(tel_seq_for);
+
+    // satellite and rDNA-like repeats in addition to the telomere, counted completely for motif density
+    MotifScanner repeats;
+    const char* repeat_motifs[] {"TTAGGGTTAGGGTTAGGGTTAGGGTTAGGG", "ATTCCATTCGATTCCATTCGATTCC", "GGAATGGAATGGAATGGAAT", "TTCCATTCCATTCCATTCCA", "CGCGCCGGCGCGGGGCGGGG", "AATGGAATGGAATCGAATGG"};
+    for (const char* motif : repeat_motifs){
+        repeats.add_motif(motif);
+    }
+
+    for (MotifKernel kernel : {MotifKernel::scalar, MotifKernel::sse2, MotifKernel::avx2}){
+        if (!telomere.set_kernel(kernel) || !repeats.set_kernel(kernel)){
+            std::cout << kernel_name(kernel) << " kernel not supported on this CPU\n";
+            continue;
+        }
+        uint64_t hits;
+        double speed {time_mb_per_s(sequences, [&](const std::string& seq){
+            return static_cast<uint64_t>(telomere.count_hits(seq.data(), seq.size(), 0) > 0);
+        }, hits)};
+        std::cout << "telomere, " << kernel_name(kernel) << " kernel:" << std::string(15 - std::string(kernel_name(kernel)).size(), ' ') << speed << " MB/s, " << hits << " sequences rejected\n";
+
+        speed = time_mb_per_s(sequences, [&](const std::string& seq){
+            return repeats.count_hits(seq.data(), seq.size());
+        }, hits);
+        std::cout << repeats.num_patterns() << " patterns, " << kernel_name(kernel) << " kernel:" << std::string(12 - std::string(kernel_name(kernel)).size(), ' ') << speed << " MB/s, " << hits << " hits\n";
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Benchmark of the topology search: nodes expanded per candidate by the single-source and bidirectional modes
+#include "../link_graph.h"
+#include "../topology_search.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace{
+    const char* graph_path {"bench/search_bench.gfa"};
+
+    // assembly-like graph: a chain of unitigs with random long-range links from repeats; half of the candidates get
+    // a few extra links to far away unitigs (like the breakpoints of an SV), the rest are false positives that
+    // their chain neighbors can bypass through one other unitig; every link is written in both directions
+    bool write_graph(uint32_t num_nodes, const std::vector<uint32_t>& candidates, std::mt19937& rng){
+        std::ofstream gfa(graph_path);
+        if (!gfa){
+            return false;
+        }
+        std::uniform_int_distribution<uint32_t> node(0, num_nodes - 1);
+        std::uniform_int_distribution<int> percent(0, 99);
+        std::uniform_int_distribution<int> extra_links(2, 12);
+        auto link = [&](uint32_t a, uint32_t b){
+            gfa << "L\tutg" << a << "\t+\tutg" << b << "\t+\t0M\n";
+            gfa << "L\tutg" << b << "\t-\tutg" << a << "\t-\t0M\n";
+        };
+
+        for (uint32_t i{0}; i < num_nodes; i++){
+            gfa << "S\tutg" << i << "\t*\tLN:i:1000\n";
+        }
+        for (uint32_t i{0}; i + 1 < num_nodes; i++){
+            link(i, i + 1);
+            if (percent(rng) < 40){
+                uint32_t other {node(rng)};
+                if (other != i){
+                    link(i, other);
+                }
+            }
+        }
+        for (auto it = candidates.begin(); it != candidates.end(); it++){
+            if (percent(rng) < 50){
+                uint32_t bypass {node(rng)};
+                if (*it > 0 && *it + 1 < num_nodes && bypass != *it){
+                    link(*it - 1, bypass);
+                    link(bypass, *it + 1);
+                }
+                continue;
+            }
+            for (int i{extra_links(rng)}; i > 0; i--){
+                uint32_t other {node(rng)};
+                if (other != *it){
+                    link(*it, other);
+                }
+            }
+        }
+        return static_cast<bool>(gfa);
+    }
+
+    struct ModeResult{
+        std::vector<topology_search::SearchOutcome> outcomes;
+        uint64_t total_expanded;
+        size_t max_expanded;
+        double seconds;
+    };
+
+    ModeResult run_mode(const LinkGraph& graph, const std::vector<uint32_t>& candidate_ids, const std::vector<bool>& is_candidate, const std::vector<bool>& all_tumor_utgs, int max_steps, topology_search::SearchMode mode){
+        ModeResult result {{}, 0, 0, 0.0};
+        topology_search::SearchWorkspace workspace;
+        auto start = std::chrono::steady_clock::now();
+        for (auto it = candidate_ids.begin(); it != candidate_ids.end(); it++){
+            result.outcomes.push_back(topology_search::search_candidate(*it, graph, is_candidate, all_tumor_utgs, max_steps, mode, workspace));
+            result.total_expanded += workspace.nodes_expanded;
+            result.max_expanded = std::max(result.max_expanded, workspace.nodes_expanded);
+        }
+        std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - start};
+        result.seconds = elapsed.count();
+        return result;
+    }
+}
+
+int main(){
+    std::mt19937 rng(42);
+    const uint32_t num_nodes {200000};
+    std::uniform_int_distribution<uint32_t> node(0, num_nodes - 1);
+    std::vector<uint32_t> candidates(2000);
+    for (auto it = candidates.begin(); it != candidates.end(); it++){
+        *it = node(rng);
+    }
+    if (!write_graph(num_nodes, candidates, rng)){
+        std::cout << "could not write " << graph_path << '\n';
+        return 1;
+    }
+
+    LinkGraph graph;
+    bool loaded {graph.load(graph_path, 1)};
+    std::remove(graph_path);
+    if (!loaded){
+        return 1;
+    }
+
+    // candidates and a few other tumor-only unitigs are excluded from the search
+    std::vector<bool> is_candidate(graph.num_nodes(), false);
+    std::vector<bool> all_tumor_utgs(graph.num_nodes(), false);
+    std::vector<uint32_t> candidate_ids;
+    for (auto it = candidates.begin(); it != candidates.end(); it++){
+        uint32_t id;
+        if (graph.get_id("utg" + std::to_string(*it), id)){
+            is_candidate[id] = true;
+            all_tumor_utgs[id] = true;
+            candidate_ids.push_back(id);
+        }
+    }
+    for (uint32_t i{0}; i < num_nodes / 50; i++){
+        all_tumor_utgs[node(rng)] = true;
+    }
+    std::cout << graph.num_nodes() << " unitigs, " << graph.num_links() << " links, " << candidate_ids.size() << " candidates\n";
+
+    for (int max_steps : {3, 5, 8, 12}){
+        ModeResult single {run_mode(graph, candidate_ids, is_candidate, all_tumor_utgs, max_steps, topology_search::SearchMode::single)};
+        ModeResult bidirectional {run_mode(graph, candidate_ids, is_candidate, all_tumor_utgs, max_steps, topology_search::SearchMode::bidirectional)};
+        size_t removed {static_cast<size_t>(std::count(single.outcomes.begin(), single.outcomes.end(), topology_search::SearchOutcome::remove))};
+        double n {static_cast<double>(candidate_ids.size())};
+
+        std::cout << "k=" << max_steps << ": " << removed << " candidates removed, decisions " << (single.outcomes == bidirectional.outcomes ? "identical" : "DIFFERENT") << '\n';
+        std::cout << "    single:        " << static_cast<double>(single.total_expanded) / n << " nodes expanded per candidate (max " << single.max_expanded << "), " << single.seconds * 1000 << " ms\n";
+        std::cout << "    bidirectional: " << static_cast<double>(bidirectional.total_expanded) / n << " nodes expanded per candidate (max " << bidirectional.max_expanded << "), " << bidirectional.seconds * 1000 << " ms\n";
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+// Benchmark of the graph stages on synthetic co-assembly graphs of several sizes: GFA filtering, link graph loading and the
+// topology search, in unitigs (or candidates) per second for each number of threads
+#include "gfa_generator.h"
+#include "../argument_parser.h"
+#include "../link_graph.h"
+#include "../preprocess.h"
+#include "../run_metrics.h"
+#include "../topology_search.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace{
+    const std::string out_dir {"bench/stage_bench_out"};
+    const std::string graph_path {out_dir + "/graph.gfa"};
+
+    struct StageTimes{
+        double filter_seconds;
+        double load_seconds;
+        double search_seconds;
+        size_t num_candidates;
+        size_t bubbles_kept;
+    };
+
+    double seconds_since(const std::chrono::steady_clock::time_point& start){
+        std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - start};
+        return elapsed.count();
+    }
+
+    // thread counts in powers of two up to the number of hardware threads, and that number itself
+    std::vector<unsigned> thread_counts(){
+        unsigned max_threads {std::max(std::thread::hardware_concurrency(), 1u)};
+        std::vector<unsigned> counts;
+        for (unsigned threads{1}; threads < max_threads; threads *= 2){
+            counts.push_back(threads);
+        }
+        counts.push_back(max_threads);
+        return counts;
+    }
+
+    // the stages write their usual output files into out_dir; their progress messages are not printed
+    bool run_stages(ArgumentParser& args, const std::unordered_set<std::string>& bubbles, StageTimes& times){
+        std::streambuf* cout_buffer {std::cout.rdbuf()};
+        std::ofstream discard;
+        std::cout.rdbuf(discard.rdbuf());
+        RunMetrics metrics("bench");
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok {preprocess::filter_unitigs(args, metrics.begin_stage("gfa_filter"))};
+        times.filter_seconds = seconds_since(start);
+
+        LinkGraph graph;
+        start = std::chrono::steady_clock::now();
+        ok = ok && graph.load(graph_path, static_cast<unsigned>(std::stoi(args.args["-t"])));
+        times.load_seconds = seconds_since(start);
+
+        std::unordered_set<std::string> candidates;
+        std::unordered_map<std::string, size_t> passed;
+        std::ifstream thresh_file(out_dir + "/intermediate_output/thresh_tumor_only_unitigs.txt");
+        std::string utg;
+        while (thresh_file >> utg){
+            candidates.insert(utg);
+        }
+        std::string utg_path {out_dir + "/intermediate_output/all_tumor_only_unitigs.txt"};
+        std::vector<bool> all_tumor_utgs {topology_search::load_tumor_unitigs(utg_path, graph)};
+        times.num_candidates = candidates.size();
+
+        start = std::chrono::steady_clock::now();
+        ok = ok && topology_search::run_topology_search(args, graph, all_tumor_utgs, candidates, {}, passed, metrics.begin_stage("topology_search"));
+        times.search_seconds = seconds_since(start);
+
+        times.bubbles_kept = 0;
+        for (auto it = bubbles.begin(); it != bubbles.end(); it++){
+            times.bubbles_kept += passed.count(*it);
+        }
+        std::cout.rdbuf(cout_buffer);
+        return ok;
+    }
+}
+
+int main(int argc, char** argv){
+    std::vector<uint32_t> sizes {20000, 100000, 400000};
+    if (argc > 1){
+        sizes.clear();
+        for (int i{1}; i < argc; i++){
+            sizes.push_back(static_cast<uint32_t>(std::stoul(argv[i])));
+        }
+    }
+
+    char command[] {"preprocess"};
+    char* parser_argv[] {argv[0], command, nullptr};
+    int parser_argc {2};
+    ArgumentParser args(parser_argc, parser_argv);
+    args.args["-o"] = out_dir;
+    args.args["--graph"] = graph_path;
+    args.args["--tumor-ids"] = "tum1";
+    args.args["--read-sep"] = "/";
+    args.args["--min-reads"] = "2";
+    args.args["--max-motif-density"] = "0";
+    args.args["--support-table"] = out_dir + "/intermediate_output/unitig_support.bin";
+    args.args["-k"] = "8";
+    args.args["--search"] = "single";
+    args.args["--component-prepass"] = "no";
+    preprocess::file_setup(args);
+
+    for (auto size = sizes.begin(); size != sizes.end(); size++){
+        GeneratorOptions opt;
+        opt.num_nodes = *size;
+        opt.num_bubbles = std::max(*size / 1000, 1u);
+        GeneratedGraph generated;
+        if (!gfa_generator::write_gfa(graph_path, opt, generated)){
+            std::cout << "could not write " << graph_path << '\n';
+            return 1;
+        }
+        std::unordered_set<std::string> bubbles(generated.bubble_names.begin(), generated.bubble_names.end());
+        double num_unitigs {static_cast<double>(generated.num_segments)};
+        std::cout << generated.num_segments << " unitigs (" << generated.num_tumor_only << " tumor-only), " << generated.num_links << " links, "
+                  << static_cast<double>(run_metrics::file_size(graph_path)) / (1024 * 1024) << " MB\n";
+
+        std::vector<unsigned> threads {thread_counts()};
+        for (auto it = threads.begin(); it != threads.end(); it++){
+            args.args["-t"] = std::to_string(*it);
+            StageTimes times;
+            if (!run_stages(args, bubbles, times)){
+                std::cout << "stages failed with " << *it << " threads\n";
+                return 1;
+            }
+            std::cout << "    t=" << *it << ": gfa_filter " << num_unitigs / times.filter_seconds / 1e6 << " M unitigs/s, link_graph "
+                      << num_unitigs / times.load_seconds / 1e6 << " M unitigs/s, topology_search (k=" << args.args["-k"] << ") "
+                      << static_cast<double>(times.num_candidates) / times.search_seconds << " candidates/s, "
+                      << times.bubbles_kept << '/' << bubbles.size() << " translocation bubbles kept\n";
+        }
+    }
+
+    std::string cmd {"rm -rf " + out_dir};
+    system(cmd.c_str());
+    return 0;
+}
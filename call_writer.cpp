@@ -0,0 +1,221 @@
+#include "call_writer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <zlib.h>
+
+namespace{
+    // BGZF blocks hold at most 64 KB; bgzip fills them with 0xff00 bytes so that incompressible data still fits
+    const size_t bgzf_block_input {0xff00};
+    const size_t bgzf_block_max {0x10000};
+    const size_t bgzf_header_size {18};
+    const size_t bgzf_footer_size {8};
+    const size_t plain_buffer_size {1 << 20};
+
+    void put_le16(unsigned char* p, size_t value){
+        p[0] = static_cast<unsigned char>(value & 0xff);
+        p[1] = static_cast<unsigned char>((value >> 8) & 0xff);
+    }
+
+    void put_le32(unsigned char* p, size_t value){
+        put_le16(p, value & 0xffff);
+        put_le16(p + 2, (value >> 16) & 0xffff);
+    }
+
+    // splits off the first num_fields whitespace separated fields of a line, like awk does
+    size_t awk_fields(const char* line, const char* line_end, const char** starts, size_t* sizes, size_t num_fields){
+        size_t found {0};
+        const char* p {line};
+        while (found < num_fields){
+            while (p < line_end && (*p == ' ' || *p == '\t')){
+                p++;
+            }
+            if (p == line_end){
+                break;
+            }
+            starts[found] = p;
+            while (p < line_end && *p != ' ' && *p != '\t'){
+                p++;
+            }
+            sizes[found] = static_cast<size_t>(p - starts[found]);
+            found++;
+        }
+        return found;
+    }
+
+    // breakpoint between different contigs: orientation in column 3 and different contigs in columns 1 and 4
+    bool is_translocation(const char* line, const char* line_end){
+        const char* starts[4];
+        size_t sizes[4];
+        if (awk_fields(line, line_end, starts, sizes, 4) < 4){
+            return false;
+        }
+        if (std::memchr(starts[2], '>', sizes[2]) == nullptr && std::memchr(starts[2], '<', sizes[2]) == nullptr){
+            return false;
+        }
+        return sizes[0] != sizes[3] || std::memcmp(starts[0], starts[3], sizes[0]) != 0;
+    }
+
+    // calls within the masked regions are marked with a region distance of 0
+    bool in_masked_region(const char* line, const char* line_end){
+        static const char marker[] {"cen_dist=0;"};
+        const size_t marker_size {sizeof(marker) - 1};
+        for (const char* p {line}; static_cast<size_t>(line_end - p) >= marker_size; p++){
+            p = static_cast<const char*>(std::memchr(p, 'c', static_cast<size_t>(line_end - p) - marker_size + 1));
+            if (p == nullptr){
+                return false;
+            }
+            if (std::memcmp(p, marker, marker_size) == 0){
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+OutputSink::OutputSink() : file(nullptr), compress(false), failed(false), buffer(), block(){}
+
+OutputSink::~OutputSink(){
+    close();
+}
+
+bool OutputSink::open(const std::string& path, bool compress){
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    this->compress = compress;
+    failed = file == nullptr;
+    buffer.clear();
+    if (compress){
+        block.resize(bgzf_block_max);
+    }
+    return !failed;
+}
+
+void OutputSink::write(const char* data, size_t size){
+    buffer.append(data, size);
+    if (buffer.size() >= (compress ? bgzf_block_input : plain_buffer_size)){
+        flush_buffer(false);
+    }
+}
+
+bool OutputSink::close(){
+    if (file == nullptr){
+        return !failed;
+    }
+    flush_buffer(true);
+    // an empty block marks the end of a BGZF file
+    if (compress){
+        write_block(nullptr, 0);
+    }
+    if (std::fclose(file) != 0){
+        failed = true;
+    }
+    file = nullptr;
+    return !failed;
+}
+
+bool OutputSink::flush_buffer(bool final_flush){
+    if (!compress){
+        if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()){
+            failed = true;
+        }
+        buffer.clear();
+        return !failed;
+    }
+
+    // compressed output is written in full blocks; the rest waits for more data unless this is the last flush
+    size_t written {0};
+    while (buffer.size() - written >= bgzf_block_input || (final_flush && written < buffer.size())){
+        size_t size {std::min(bgzf_block_input, buffer.size() - written)};
+        write_block(buffer.data() + written, size);
+        written += size;
+    }
+    buffer.erase(0, written);
+    return !failed;
+}
+
+/* Writes one BGZF block: gzip header with the BC extra field holding the block size, raw deflate data, CRC32 and input size */
+bool OutputSink::write_block(const char* data, size_t size){
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK){
+        failed = true;
+        return false;
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = block.data() + bgzf_header_size;
+    stream.avail_out = static_cast<uInt>(bgzf_block_max - bgzf_header_size - bgzf_footer_size);
+    int status {deflate(&stream, Z_FINISH)};
+    size_t compressed_size {static_cast<size_t>(stream.total_out)};
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END){
+        std::cout << "[OutputSink::write_block][ERROR] could not compress output block\n";
+        failed = true;
+        return false;
+    }
+
+    const unsigned char header[] {31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0};
+    size_t block_size {bgzf_header_size + compressed_size + bgzf_footer_size};
+    std::memcpy(block.data(), header, sizeof(header));
+    put_le16(block.data() + 16, block_size - 1);
+
+    uLong crc {crc32(0L, Z_NULL, 0)};
+    if (size > 0){
+        crc = crc32(crc, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(size));
+    }
+    put_le32(block.data() + bgzf_header_size + compressed_size, crc);
+    put_le32(block.data() + bgzf_header_size + compressed_size + 4, size);
+
+    if (std::fwrite(block.data(), 1, block_size, file) != block_size){
+        failed = true;
+    }
+    return !failed;
+}
+
+CallSetWriter::CallSetWriter() : all_calls(), all_calls_filtered(), translocations(), translocations_filtered(){}
+
+bool CallSetWriter::open(const std::string& out_dir, bool compress){
+    std::string suffix {compress ? ".sv.gz" : ".sv"};
+    if (!all_calls.open(out_dir + "/sv_calls" + suffix, compress) ||
+        !all_calls_filtered.open(out_dir + "/sv_calls_region_filtered" + suffix, compress) ||
+        !translocations.open(out_dir + "/translocations" + suffix, compress) ||
+        !translocations_filtered.open(out_dir + "/translocations_region_filtered" + suffix, compress)){
+        std::cout << "[CallSetWriter::open][ERROR] could not create call set files in " << out_dir << '\n';
+        return false;
+    }
+    return true;
+}
+
+void CallSetWriter::write(const char* records, size_t size){
+    const char* line {records};
+    const char* end {records + size};
+    while (line < end){
+        const char* newline {static_cast<const char*>(std::memchr(line, '\n', static_cast<size_t>(end - line)))};
+        const char* line_end {newline == nullptr ? end : newline};
+        size_t line_size {static_cast<size_t>(line_end - line) + (newline == nullptr ? 0 : 1)};
+
+        bool translocation {is_translocation(line, line_end)};
+        bool masked {in_masked_region(line, line_end)};
+        all_calls.write(line, line_size);
+        if (!masked){
+            all_calls_filtered.write(line, line_size);
+        }
+        if (translocation){
+            translocations.write(line, line_size);
+            if (!masked){
+                translocations_filtered.write(line, line_size);
+            }
+        }
+        line += line_size;
+    }
+}
+
+bool CallSetWriter::close(){
+    bool closed {all_calls.close()};
+    closed = all_calls_filtered.close() && closed;
+    closed = translocations.close() && closed;
+    closed = translocations_filtered.close() && closed;
+    return closed;
+}
@@ -0,0 +1,53 @@
+#ifndef CALL_WRITER_H
+#define CALL_WRITER_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Buffered output file, written either as plain text or as BGZF (blocked gzip, readable by gzip -d and bgzip)
+class OutputSink{
+	public:
+		OutputSink();
+		~OutputSink();
+		OutputSink(const OutputSink&) = delete;
+		OutputSink& operator=(const OutputSink&) = delete;
+
+		bool open(const std::string& path, bool compress);
+		void write(const char* data, size_t size);
+		bool close();
+
+	private:
+		bool flush_buffer(bool final_flush);
+		bool write_block(const char* data, size_t size);
+
+		std::FILE* file;
+		bool compress;
+		bool failed;
+		std::string buffer;
+		std::vector<unsigned char> block;
+};
+
+// Writes the four call sets of call (sv_calls, translocations and their region filtered versions) in one pass:
+// every SV record is classified once and appended to each call set it belongs to
+class CallSetWriter{
+	public:
+		CallSetWriter();
+		CallSetWriter(const CallSetWriter&) = delete;
+		CallSetWriter& operator=(const CallSetWriter&) = delete;
+
+		// opens <out_dir>/sv_calls.sv and friends, with a .gz suffix when compressed
+		bool open(const std::string& out_dir, bool compress);
+		// records must be complete, newline terminated lines in the format of sv_extract
+		void write(const char* records, size_t size);
+		bool close();
+
+	private:
+		OutputSink all_calls;
+		OutputSink all_calls_filtered;
+		OutputSink translocations;
+		OutputSink translocations_filtered;
+};
+
+#endif
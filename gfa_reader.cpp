@@ -0,0 +1,289 @@
+#include "gfa_reader.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace{
+    // decompressed bytes added to the buffer per batch; every window holds at least one batch unless the file ends first
+    const size_t batch_size {size_t{128} << 20};
+    const size_t gzip_header_size {12};
+    const size_t gzip_footer_size {8};
+
+    size_t get_le16(const unsigned char* p){
+        return static_cast<size_t>(p[0]) | static_cast<size_t>(p[1]) << 8;
+    }
+
+    uint32_t get_le32(const unsigned char* p){
+        return static_cast<uint32_t>(get_le16(p) | get_le16(p + 2) << 16);
+    }
+
+    // size of the BGZF block starting at p (from the BC extra field), or 0 if p does not start a BGZF block
+    size_t bgzf_block_size(const unsigned char* p, size_t available){
+        if (available < gzip_header_size + gzip_footer_size || p[0] != 31 || p[1] != 139 || p[2] != 8 || (p[3] & 4) == 0){
+            return 0;
+        }
+        size_t extra_end {gzip_header_size + get_le16(p + 10)};
+        if (extra_end > available){
+            return 0;
+        }
+        for (size_t pos{gzip_header_size}; pos + 4 <= extra_end; pos += 4 + get_le16(p + pos + 2)){
+            if (p[pos] == 'B' && p[pos + 1] == 'C' && get_le16(p + pos + 2) == 2 && pos + 6 <= extra_end){
+                size_t block_size {get_le16(p + pos + 4) + 1};
+                return block_size >= extra_end + gzip_footer_size && block_size <= available ? block_size : 0;
+            }
+        }
+        return 0;
+    }
+
+    // start of the last S or L line in [0, size), or 0 if there is none after the first line
+    size_t last_record_start(const char* text, size_t size){
+        for (size_t pos{size}; pos > 1; pos--){
+            if (text[pos - 2] == '\n' && (text[pos - 1] == 'S' || text[pos - 1] == 'L')){
+                return pos - 1;
+            }
+        }
+        return 0;
+    }
+}
+
+GfaReader::GfaReader() : file(), format(Format::plain), num_threads(1), file_pos(0), finished(false), error(false), text_read(0), buffer(), buffer_capacity(0), buffer_used(0), window_size(0), window_start(0), stream(), stream_open(false){}
+
+GfaReader::~GfaReader(){
+    close();
+}
+
+bool GfaReader::open(const std::string& path, unsigned num_threads){
+    close();
+    if (!file.open(path)){
+        return false;
+    }
+    this->num_threads = std::max(num_threads, 1u);
+
+    const unsigned char* data {reinterpret_cast<const unsigned char*>(file.data())};
+    if (file.size() < 2 || data[0] != 31 || data[1] != 139){
+        format = Format::plain;
+    }else if (bgzf_block_size(data, file.size()) > 0){
+        format = Format::bgzf;
+    }else{
+        // a plain gzip stream has no block boundaries to decompress from in parallel
+        format = Format::gzip;
+        if (inflateInit2(&stream, 15 + 16) != Z_OK){
+            std::cout << "[GfaReader::open][ERROR] could not start decompression of " << path << '\n';
+            file.close();
+            return false;
+        }
+        stream_open = true;
+    }
+    return true;
+}
+
+void GfaReader::close(){
+    if (stream_open){
+        inflateEnd(&stream);
+        stream_open = false;
+    }
+    file.close();
+    format = Format::plain;
+    file_pos = 0;
+    finished = false;
+    error = false;
+    text_read = 0;
+    buffer.reset();
+    buffer_capacity = 0;
+    buffer_used = 0;
+    window_size = 0;
+    window_start = 0;
+}
+
+bool GfaReader::next(const char*& begin, const char*& end){
+    if (error){
+        return false;
+    }
+    if (format == Format::plain){
+        if (finished || file.size() == 0){
+            return false;
+        }
+        finished = true;
+        text_read = file.size();
+        begin = file.data();
+        end = begin + file.size();
+        return true;
+    }
+
+    // the partial record after the last window moves to the front, and new text is decompressed after it
+    if (window_size > 0){
+        window_start += window_size;
+        std::memmove(buffer.get(), buffer.get() + window_size, buffer_used - window_size);
+        buffer_used -= window_size;
+        window_size = 0;
+    }
+    while (window_size == 0){
+        bool added {format == Format::bgzf ? fill_bgzf() : fill_gzip()};
+        if (error){
+            return false;
+        }
+        if (!added){
+            if (buffer_used == 0){
+                return false;
+            }
+            window_size = buffer_used;
+        }else{
+            // a record that does not fit into one batch makes the window grow by another batch
+            window_size = last_record_start(buffer.get(), buffer_used);
+        }
+    }
+    begin = buffer.get();
+    end = begin + window_size;
+    return true;
+}
+
+bool GfaReader::failed() const{
+    return error;
+}
+
+bool GfaReader::is_compressed() const{
+    return format != Format::plain;
+}
+
+uint64_t GfaReader::file_size() const{
+    return file.size();
+}
+
+uint64_t GfaReader::text_size() const{
+    return text_read;
+}
+
+uint64_t GfaReader::window_offset() const{
+    return window_start;
+}
+
+// the buffer is left uninitialized, since every byte is written by decompression before it is read
+void GfaReader::reserve(size_t size){
+    if (buffer_capacity < size){
+        size_t capacity {std::max(size, buffer_capacity + buffer_capacity / 2)};
+        std::unique_ptr<char[]> grown(new char[capacity]);
+        if (buffer_used > 0){
+            std::memcpy(grown.get(), buffer.get(), buffer_used);
+        }
+        buffer.swap(grown);
+        buffer_capacity = capacity;
+    }
+}
+
+/* Decompresses the next batch of BGZF blocks; the block sizes in the headers give every block's place in the buffer,
+   so the blocks are inflated independently on all threads */
+bool GfaReader::fill_bgzf(){
+    struct Block{
+        size_t data_offset;
+        size_t data_size;
+        size_t text_offset;
+        size_t text_size;
+        uint32_t crc;
+    };
+    const unsigned char* data {reinterpret_cast<const unsigned char*>(file.data())};
+    std::vector<Block> blocks;
+    size_t batch_text {0};
+    while (file_pos < file.size() && batch_text < batch_size){
+        const unsigned char* block {data + file_pos};
+        size_t block_size {bgzf_block_size(block, file.size() - file_pos)};
+        if (block_size == 0){
+            std::cout << "[GfaReader::fill_bgzf][ERROR] corrupt BGZF block at byte " << file_pos << " of the graph file\n";
+            error = true;
+            return false;
+        }
+        size_t header_size {gzip_header_size + get_le16(block + 10)};
+        size_t text_size {get_le32(block + block_size - 4)};
+        // the empty block at the end of the file holds no text
+        if (text_size > 0){
+            blocks.push_back({file_pos + header_size, block_size - header_size - gzip_footer_size, buffer_used + batch_text, text_size, get_le32(block + block_size - 8)});
+        }
+        batch_text += text_size;
+        file_pos += block_size;
+    }
+    if (blocks.empty()){
+        return false;
+    }
+
+    reserve(buffer_used + batch_text);
+    std::vector<z_stream> streams(num_threads);
+    std::vector<char> stream_ready(num_threads, 0);
+    std::vector<char> block_ok(blocks.size(), 0);
+    WorkStealingPool pool(blocks.size(), num_threads, [&](unsigned worker_id, size_t i){
+        z_stream& block_stream {streams[worker_id]};
+        if (!stream_ready[worker_id]){
+            if (inflateInit2(&block_stream, -15) != Z_OK){
+                return;
+            }
+            stream_ready[worker_id] = 1;
+        }else{
+            inflateReset(&block_stream);
+        }
+        const Block& block {blocks[i]};
+        Bytef* text {reinterpret_cast<Bytef*>(buffer.get() + block.text_offset)};
+        block_stream.next_in = const_cast<Bytef*>(data + block.data_offset);
+        block_stream.avail_in = static_cast<uInt>(block.data_size);
+        block_stream.next_out = text;
+        block_stream.avail_out = static_cast<uInt>(block.text_size);
+        if (inflate(&block_stream, Z_FINISH) == Z_STREAM_END && block_stream.total_out == block.text_size){
+            block_ok[i] = crc32(crc32(0L, Z_NULL, 0), text, static_cast<uInt>(block.text_size)) == block.crc;
+        }
+    });
+    pool.join();
+    for (unsigned i{0}; i < num_threads; i++){
+        if (stream_ready[i]){
+            inflateEnd(&streams[i]);
+        }
+    }
+
+    auto bad_block = std::find(block_ok.begin(), block_ok.end(), 0);
+    if (bad_block != block_ok.end()){
+        std::cout << "[GfaReader::fill_bgzf][ERROR] could not decompress BGZF block at byte " << blocks[static_cast<size_t>(bad_block - block_ok.begin())].data_offset << " of the graph file\n";
+        error = true;
+        return false;
+    }
+    buffer_used += batch_text;
+    text_read += batch_text;
+    return true;
+}
+
+/* Decompresses the next batch of a gzip stream; concatenated gzip members are read one after another */
+bool GfaReader::fill_gzip(){
+    if (finished){
+        return false;
+    }
+    reserve(buffer_used + batch_size);
+    stream.next_out = reinterpret_cast<Bytef*>(buffer.get() + buffer_used);
+    stream.avail_out = static_cast<uInt>(batch_size);
+    while (stream.avail_out > 0){
+        if (stream.avail_in == 0){
+            if (file_pos == file.size()){
+                std::cout << "[GfaReader::fill_gzip][ERROR] graph file ends in the middle of a gzip stream\n";
+                error = true;
+                return false;
+            }
+            size_t input_size {std::min(file.size() - file_pos, size_t{1} << 30)};
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(file.data() + file_pos));
+            stream.avail_in = static_cast<uInt>(input_size);
+            file_pos += input_size;
+        }
+        int status {inflate(&stream, Z_NO_FLUSH)};
+        if (status == Z_STREAM_END){
+            if (stream.avail_in == 0 && file_pos == file.size()){
+                finished = true;
+                break;
+            }
+            inflateReset(&stream);
+        }else if (status != Z_OK){
+            std::cout << "[GfaReader::fill_gzip][ERROR] could not decompress graph file: " << (stream.msg == nullptr ? "corrupt data" : stream.msg) << '\n';
+            error = true;
+            return false;
+        }
+    }
+    size_t added {batch_size - stream.avail_out};
+    buffer_used += added;
+    text_read += added;
+    return added > 0;
+}
@@ -0,0 +1,60 @@
+#ifndef GFA_READER_H
+#define GFA_READER_H
+
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <zlib.h>
+
+// Reads a .gfa or .gfa.gz file as a series of windows that each end right before an S or L line, so that no window splits
+// a segment from its A lines; plain files are mapped and read as one window, BGZF files are decompressed in batches of
+// blocks on several threads, and other gzip files are decompressed as one stream
+class GfaReader{
+	public:
+		GfaReader();
+		~GfaReader();
+		GfaReader(const GfaReader&) = delete;
+		GfaReader& operator=(const GfaReader&) = delete;
+
+		bool open(const std::string& path, unsigned num_threads);
+		void close();
+
+		// sets [begin, end) to the next window, which stays valid until the next call; false at the end of the file or on error
+		bool next(const char*& begin, const char*& end);
+		bool failed() const;
+		bool is_compressed() const;
+		// size of the file on disk, and the number of decompressed bytes read so far
+		uint64_t file_size() const;
+		uint64_t text_size() const;
+		// offset of the current window in the decompressed text
+		uint64_t window_offset() const;
+
+	private:
+		enum class Format{plain, bgzf, gzip};
+
+		bool fill_bgzf();
+		bool fill_gzip();
+		void reserve(size_t size);
+
+		MappedFile file;
+		Format format;
+		unsigned num_threads;
+		size_t file_pos;
+		bool finished;
+		bool error;
+		uint64_t text_read;
+
+		// decompressed text: the window handed out last, then the start of the record that follows it
+		std::unique_ptr<char[]> buffer;
+		size_t buffer_capacity;
+		size_t buffer_used;
+		size_t window_size;
+		uint64_t window_start;
+		z_stream stream;
+		bool stream_open;
+};
+
+#endif
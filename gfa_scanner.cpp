@@ -0,0 +1,249 @@
+#include "gfa_scanner.h"
+
+#include <cstring>
+
+namespace{
+    // 64-bit FNV-1a
+    uint64_t fnv1a(const char* key, size_t length){
+        uint64_t result {14695981039346656037ULL};
+        for (size_t i{0}; i < length; i++){
+            result ^= static_cast<unsigned char>(key[i]);
+            result *= 1099511628211ULL;
+        }
+        return result;
+    }
+}
+
+std::string TextSpan::str() const{
+    return std::string(data, size);
+}
+
+SampleTable::SampleTable() : slots(16), used(16, 0), num_ids(0){}
+
+// open addressing with linear probing; the table is kept at most half full
+void SampleTable::add(const std::string& sample_id){
+    if (contains(sample_id.data(), sample_id.size())){
+        return;
+    }
+    if (2 * (num_ids + 1) > slots.size()){
+        std::vector<std::string> old_slots;
+        std::vector<char> old_used;
+        old_slots.swap(slots);
+        old_used.swap(used);
+        slots.assign(old_slots.size() * 2, std::string());
+        used.assign(old_used.size() * 2, 0);
+        num_ids = 0;
+        for (size_t i{0}; i < old_slots.size(); i++){
+            if (old_used[i]){
+                add(old_slots[i]);
+            }
+        }
+    }
+
+    size_t mask {slots.size() - 1};
+    size_t pos {static_cast<size_t>(hash(sample_id.data(), sample_id.size())) & mask};
+    while (used[pos]){
+        pos = (pos + 1) & mask;
+    }
+    slots[pos] = sample_id;
+    used[pos] = 1;
+    num_ids++;
+}
+
+bool SampleTable::contains(const char* key, size_t length) const{
+    size_t mask {slots.size() - 1};
+    size_t pos {static_cast<size_t>(hash(key, length)) & mask};
+    while (used[pos]){
+        if (slots[pos].size() == length && std::memcmp(slots[pos].data(), key, length) == 0){
+            return true;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return false;
+}
+
+size_t SampleTable::size() const{
+    return num_ids;
+}
+
+uint64_t SampleTable::hash(const char* key, size_t length){
+    return fnv1a(key, length);
+}
+
+SampleIndex::SampleIndex() : slots(16, 0), names(){}
+
+// open addressing with linear probing, like SampleTable; the slots only hold numbers, so growing the table does not copy names
+uint32_t SampleIndex::id(const char* key, size_t length){
+    size_t mask {slots.size() - 1};
+    size_t pos {static_cast<size_t>(fnv1a(key, length)) & mask};
+    while (slots[pos] != 0){
+        const std::string& slot_name {names[slots[pos] - 1]};
+        if (slot_name.size() == length && std::memcmp(slot_name.data(), key, length) == 0){
+            return slots[pos] - 1;
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    uint32_t new_id {static_cast<uint32_t>(names.size())};
+    names.emplace_back(key, length);
+    if (2 * names.size() > slots.size()){
+        slots.assign(slots.size() * 2, 0);
+        mask = slots.size() - 1;
+        for (uint32_t i{0}; i < names.size(); i++){
+            pos = static_cast<size_t>(fnv1a(names[i].data(), names[i].size())) & mask;
+            while (slots[pos] != 0){
+                pos = (pos + 1) & mask;
+            }
+            slots[pos] = i + 1;
+        }
+    }else{
+        slots[pos] = new_id + 1;
+    }
+    return new_id;
+}
+
+const std::string& SampleIndex::name(uint32_t id) const{
+    return names[id];
+}
+
+size_t SampleIndex::size() const{
+    return names.size();
+}
+
+size_t gfa_scanner::split_fields(const char* line, const char* line_end, TextSpan* fields, size_t max_fields){
+    size_t num_fields {0};
+    const char* field_start {line};
+    while (num_fields < max_fields){
+        const char* tab {static_cast<const char*>(std::memchr(field_start, '\t', static_cast<size_t>(line_end - field_start)))};
+        const char* field_end {tab == nullptr ? line_end : tab};
+        fields[num_fields].data = field_start;
+        fields[num_fields].size = static_cast<size_t>(field_end - field_start);
+        num_fields++;
+        if (tab == nullptr){
+            break;
+        }
+        field_start = tab + 1;
+    }
+    return num_fields;
+}
+
+void gfa_scanner::scan_segments(const char* begin, const char* end, const SampleTable& tumor_ids, char read_delim, const std::function<void(const SegmentSupport&)>& on_segment){
+    scan_graph(begin, end, tumor_ids, read_delim, on_segment, nullptr, nullptr);
+}
+
+void gfa_scanner::scan_graph(const char* begin, const char* end, const SampleTable& tumor_ids, char read_delim, const std::function<void(const SegmentSupport&)>& on_segment,
+    const std::function<void(const TextSpan&)>& on_segment_name, const std::function<void(const TextSpan&, const TextSpan&)>& on_link, SampleIndex* samples){
+    std::vector<std::pair<uint32_t, uint32_t>> sample_reads;
+    // whether each sample number is a tumor sample, so numbered samples are only looked up once
+    std::vector<char> tumor_samples;
+    SegmentSupport segment {{nullptr, 0}, {nullptr, 0}, 0, 0, samples == nullptr ? nullptr : &sample_reads};
+    bool in_segment {false};
+    TextSpan fields[5];
+
+    const char* line {begin};
+    while (line < end){
+        const char* newline {static_cast<const char*>(std::memchr(line, '\n', static_cast<size_t>(end - line)))};
+        const char* line_end {newline == nullptr ? end : newline};
+
+        if (*line == 'S'){
+            // a new S line ends the previous segment
+            if (in_segment){
+                on_segment(segment);
+            }
+            size_t num_fields {split_fields(line, line_end, fields, 3)};
+            segment.name = num_fields > 1 ? fields[1] : TextSpan{line_end, 0};
+            segment.sequence = num_fields > 2 ? fields[2] : TextSpan{line_end, 0};
+            segment.tumor_reads = 0;
+            segment.normal_reads = 0;
+            sample_reads.clear();
+            in_segment = true;
+            if (on_segment_name){
+                on_segment_name(segment.name);
+            }
+        }else if (*line == 'L'){
+            if (on_link && split_fields(line, line_end, fields, 4) == 4){
+                on_link(fields[1], fields[3]);
+            }
+        }else if (*line == 'A' && split_fields(line, line_end, fields, 5) == 5){
+            // the sample ID is the part of the read name before the first separator
+            const TextSpan& read_id {fields[4]};
+            const char* delim {static_cast<const char*>(std::memchr(read_id.data, read_delim, read_id.size))};
+            size_t prefix_length {delim == nullptr ? read_id.size : static_cast<size_t>(delim - read_id.data)};
+            if (samples != nullptr){
+                uint32_t id {samples->id(read_id.data, prefix_length)};
+                while (tumor_samples.size() <= id){
+                    const std::string& name {samples->name(static_cast<uint32_t>(tumor_samples.size()))};
+                    tumor_samples.push_back(tumor_ids.contains(name.data(), name.size()));
+                }
+                (tumor_samples[id] ? segment.tumor_reads : segment.normal_reads)++;
+                // a segment has reads from a few samples only
+                auto found = sample_reads.begin();
+                while (found != sample_reads.end() && found->first != id){
+                    found++;
+                }
+                if (found == sample_reads.end()){
+                    sample_reads.push_back({id, 1});
+                }else{
+                    found->second++;
+                }
+            }else if (tumor_ids.contains(read_id.data, prefix_length)){
+                segment.tumor_reads++;
+            }else{
+                segment.normal_reads++;
+            }
+        }
+
+        line = line_end + 1;
+    }
+
+    if (in_segment){
+        on_segment(segment);
+    }
+}
+
+void gfa_scanner::scan_links(const char* begin, const char* end, const std::function<void(const TextSpan&)>& on_segment_name, const std::function<void(const TextSpan&, const TextSpan&)>& on_link){
+    TextSpan fields[4];
+    const char* line {begin};
+    while (line < end){
+        const char* newline {static_cast<const char*>(std::memchr(line, '\n', static_cast<size_t>(end - line)))};
+        const char* line_end {newline == nullptr ? end : newline};
+
+        if (*line == 'S'){
+            size_t num_fields {split_fields(line, line_end, fields, 3)};
+            on_segment_name(num_fields > 1 ? fields[1] : TextSpan{line_end, 0});
+        }else if (*line == 'L' && split_fields(line, line_end, fields, 4) == 4){
+            on_link(fields[1], fields[3]);
+        }
+
+        line = line_end + 1;
+    }
+}
+
+std::vector<const char*> gfa_scanner::split_at_segments(const char* begin, const char* end, size_t num_chunks){
+    std::vector<const char*> bounds {begin};
+    size_t total {static_cast<size_t>(end - begin)};
+    for (size_t i{1}; i < num_chunks; i++){
+        // move forward from the even split point to the next line that starts with S
+        const char* pos {begin + total / num_chunks * i};
+        if (pos <= bounds.back()){
+            continue;
+        }
+        while (pos < end){
+            const char* newline {static_cast<const char*>(std::memchr(pos - 1, '\n', static_cast<size_t>(end - pos + 1)))};
+            if (newline == nullptr || newline + 1 >= end){
+                pos = end;
+            }else if (newline[1] == 'S'){
+                pos = newline + 1;
+                break;
+            }else{
+                pos = newline + 2;
+            }
+        }
+        if (pos >= end){
+            break;
+        }
+        bounds.push_back(pos);
+    }
+    bounds.push_back(end);
+    return bounds;
+}
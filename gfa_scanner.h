@@ -0,0 +1,82 @@
+#ifndef GFA_SCANNER_H
+#define GFA_SCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Non-owning view of a range of characters, usually inside a mapped file
+struct TextSpan{
+	const char* data;
+	size_t size;
+
+	std::string str() const;
+};
+
+// Hash table of sample IDs (the read name prefix before the read separator)
+class SampleTable{
+	public:
+		SampleTable();
+		void add(const std::string& sample_id);
+		bool contains(const char* key, size_t length) const;
+		size_t size() const;
+
+	private:
+		static uint64_t hash(const char* key, size_t length);
+
+		std::vector<std::string> slots;
+		std::vector<char> used;
+		size_t num_ids;
+};
+
+// Numbers sample IDs in order of first appearance
+class SampleIndex{
+	public:
+		SampleIndex();
+		// returns the number of the sample, adding it if it is new
+		uint32_t id(const char* key, size_t length);
+		const std::string& name(uint32_t id) const;
+		size_t size() const;
+
+	private:
+		// number + 1 of the sample in each slot, 0 for an empty slot
+		std::vector<uint32_t> slots;
+		std::vector<std::string> names;
+};
+
+// One S line together with the read support counted from the A lines that follow it
+struct SegmentSupport{
+	TextSpan name;
+	TextSpan sequence;
+	uint32_t tumor_reads;
+	uint32_t normal_reads;
+	// (sample number, reads) of every sample of the A lines, in order of first appearance; nullptr unless samples are numbered
+	const std::vector<std::pair<uint32_t, uint32_t>>* sample_reads;
+};
+
+namespace gfa_scanner{
+	// splits [line, line_end) on tabs into at most max_fields fields; returns the number of fields found
+	size_t split_fields(const char* line, const char* line_end, TextSpan* fields, size_t max_fields);
+
+	// walks the lines in [begin, end) and reports every segment once all of its A lines have been counted
+	// reads whose sample ID is in tumor_ids count as tumor reads, all others as normal reads
+	void scan_segments(const char* begin, const char* end, const SampleTable& tumor_ids, char read_delim, const std::function<void(const SegmentSupport&)>& on_segment);
+
+	// like scan_segments, but also reports the name of every S line and the two ends of every L line as soon as the line is
+	// reached, so that the links of the graph can be collected in the same pass
+	// if samples is given, the sample IDs of the A lines are numbered in it, and every segment has its reads counted per sample
+	void scan_graph(const char* begin, const char* end, const SampleTable& tumor_ids, char read_delim, const std::function<void(const SegmentSupport&)>& on_segment,
+		const std::function<void(const TextSpan&)>& on_segment_name, const std::function<void(const TextSpan&, const TextSpan&)>& on_link, SampleIndex* samples = nullptr);
+
+	// reports only the S names and L line ends in [begin, end), skipping the A lines
+	void scan_links(const char* begin, const char* end, const std::function<void(const TextSpan&)>& on_segment_name, const std::function<void(const TextSpan&, const TextSpan&)>& on_link);
+
+	// splits [begin, end) into about num_chunks ranges that each start at an S line, so no segment is split between ranges
+	// returns the range boundaries, starting with begin and ending with end
+	std::vector<const char*> split_at_segments(const char* begin, const char* end, size_t num_chunks);
+}
+
+#endif
@@ -0,0 +1,748 @@
+#include "gfa_reader.h"
+#include "gfa_scanner.h"
+#include "link_graph.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+namespace{
+    // binary cache layout: header, then offsets, targets, name offsets, name order and the name characters
+    // every table starts on an 8-byte boundary so it can be used in place after mapping
+    const char cache_magic[8] {'C', 'S', 'V', 'G', 'R', 'A', 'P', 'H'};
+    const uint32_t cache_version {4};
+
+    struct CacheHeader{
+        char magic[8];
+        uint32_t version;
+        uint32_t node_count;
+        uint64_t link_count;
+        uint64_t names_size;
+        // 1 if every link is matched by its reverse link
+        uint64_t symmetric;
+        FileFingerprint gfa;
+    };
+
+    struct CacheLayout{
+        uint64_t offsets;
+        uint64_t targets;
+        uint64_t name_offsets;
+        uint64_t name_order;
+        uint64_t names;
+        uint64_t total;
+    };
+
+    uint64_t pad8(uint64_t bytes){
+        return (bytes + 7) / 8 * 8;
+    }
+
+    CacheLayout cache_layout(const CacheHeader& header){
+        CacheLayout layout;
+        layout.offsets = sizeof(CacheHeader);
+        layout.targets = layout.offsets + pad8((header.node_count + uint64_t{1}) * sizeof(uint64_t));
+        layout.name_offsets = layout.targets + pad8(header.link_count * sizeof(uint32_t));
+        layout.name_order = layout.name_offsets + pad8((header.node_count + uint64_t{1}) * sizeof(uint64_t));
+        layout.names = layout.name_order + pad8(header.node_count * sizeof(uint32_t));
+        layout.total = layout.names + pad8(header.names_size);
+        return layout;
+    }
+
+    void write_padded(std::ofstream& out, const void* data, uint64_t bytes){
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        const char zeros[8] {};
+        out.write(zeros, static_cast<std::streamsize>(pad8(bytes) - bytes));
+    }
+
+    // reads back a run of links written by LinkGraphBuilder, a buffer at a time
+    class LinkRun{
+        public:
+            LinkRun(const std::string& path, size_t buffer_links) : in(path, std::ios::binary), buffer(buffer_links), pos(0), size(0){}
+
+            bool next(std::pair<uint32_t, uint32_t>& link){
+                if (pos == size){
+                    in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(buffer[0])));
+                    size = static_cast<size_t>(in.gcount()) / sizeof(buffer[0]);
+                    pos = 0;
+                    if (size == 0){
+                        return false;
+                    }
+                }
+                link = buffer[pos++];
+                return true;
+            }
+
+            bool failed() const{
+                return in.bad() || !in.is_open();
+            }
+
+        private:
+            std::ifstream in;
+            std::vector<std::pair<uint32_t, uint32_t>> buffer;
+            size_t pos;
+            size_t size;
+    };
+
+    // head of a run during the merge; ties between sources go to the earlier run, so links keep their file order
+    struct RunHead{
+        uint32_t source;
+        uint32_t target;
+        size_t run;
+
+        bool operator>(const RunHead& other) const{
+            return source != other.source ? source > other.source : run > other.run;
+        }
+    };
+
+    void read_links(GfaReader& gfa_file, LinkGraphBuilder& builder){
+        const char* window_begin;
+        const char* window_end;
+        while (gfa_file.next(window_begin, window_end)){
+            gfa_scanner::scan_links(window_begin, window_end, [&](const TextSpan& name){
+                builder.add_segment(name.data, name.size);
+            }, [&](const TextSpan& source, const TextSpan& target){
+                builder.add_link(source.data, source.size, target.data, target.size);
+            });
+        }
+    }
+
+    // temporary files are named after the process, so processes that build the same cache at once (e.g., the shards of a
+    // call) do not write into each other's files; the last one to finish replaces the cache
+    std::string temp_path(const std::string& path){
+        return path + ".tmp" + std::to_string(getpid());
+    }
+
+    // true if every link u -> v of the adjacency table is matched by a link v -> u; neighbor lists are short, so each reverse
+    // link is found with a linear scan and the check needs no memory of its own
+    bool check_symmetry(const uint64_t* offsets, const uint32_t* targets, uint32_t node_count){
+        for (uint32_t id{0}; id < node_count; id++){
+            for (uint64_t i{offsets[id]}; i < offsets[id + 1]; i++){
+                const uint32_t* reverse_begin {targets + offsets[targets[i]]};
+                const uint32_t* reverse_end {targets + offsets[targets[i] + 1]};
+                if (std::find(reverse_begin, reverse_end, id) == reverse_end){
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // compares the name stored at [start, end) of the name table with a lookup key
+    int compare_name(const char* start, const char* end, const std::string& key){
+        size_t length {static_cast<size_t>(end - start)};
+        int diff {std::memcmp(start, key.data(), std::min(length, key.size()))};
+        if (diff != 0){
+            return diff;
+        }
+        return length < key.size() ? -1 : (length > key.size() ? 1 : 0);
+    }
+}
+
+LinkGraph::LinkGraph() : offset_store(1, 0), target_store(), name_offset_store(1, 0), name_order_store(), name_store(), source(), built_symmetric(true), cache_file(), prefetch(false), node_count(0), link_count(0), offsets(nullptr), targets(nullptr), name_offsets(nullptr), name_order(nullptr), names(nullptr), symmetric(true){
+    update_views();
+}
+
+LinkGraphBuilder::LinkGraphBuilder() : name_to_id(), lookup_key(), name_store(), name_offsets(1, 0), links(), run_prefix(), max_links(0), run_paths(), run_failed(false){}
+
+LinkGraphBuilder::~LinkGraphBuilder(){
+    remove_runs();
+}
+
+uint32_t LinkGraphBuilder::add_segment(const char* name, size_t size){
+    return intern(name, size);
+}
+
+void LinkGraphBuilder::add_link(const char* source, size_t source_size, const char* target, size_t target_size){
+    uint32_t source_id {intern(source, source_size)};
+    uint32_t target_id {intern(target, target_size)};
+    links.push_back({source_id, target_id});
+    if (links.size() == max_links){
+        write_run();
+    }
+}
+
+void LinkGraphBuilder::spill_links(const std::string& prefix, uint64_t memory_budget){
+    run_prefix = prefix;
+    // sorting a run takes up to as much memory again as the run itself
+    max_links = std::max(static_cast<size_t>(memory_budget / (2 * sizeof(links[0]))), size_t{1} << 16);
+    links.reserve(max_links);
+}
+
+// runs are sorted by source only, so the links of a source keep their file order within the run
+void LinkGraphBuilder::write_run(){
+    std::stable_sort(links.begin(), links.end(), [](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b){
+        return a.first < b.first;
+    });
+    run_paths.push_back(temp_path(run_prefix) + ".links" + std::to_string(run_paths.size()));
+    std::ofstream out(run_paths.back(), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(links.data()), static_cast<std::streamsize>(links.size() * sizeof(links[0])));
+    out.close();
+    if (out.fail()){
+        run_failed = true;
+    }
+    links.clear();
+}
+
+void LinkGraphBuilder::remove_runs(){
+    for (auto it = run_paths.begin(); it != run_paths.end(); it++){
+        std::remove(it->c_str());
+    }
+    run_paths.clear();
+}
+
+// names are interned into one character table, with a temporary hash table for lookups while parsing
+uint32_t LinkGraphBuilder::intern(const char* name, size_t size){
+    lookup_key.assign(name, size);
+    auto found = name_to_id.find(lookup_key);
+    if (found != name_to_id.end()){
+        return found->second;
+    }
+    uint32_t id {static_cast<uint32_t>(name_to_id.size())};
+    name_to_id.insert({lookup_key, id});
+    name_store += lookup_key;
+    name_offsets.push_back(name_store.size());
+    return id;
+}
+
+// Reads every S and L line of the .gfa file once and builds the adjacency table
+bool LinkGraph::load(const std::string& gfa_path, unsigned num_threads){
+    FileFingerprint gfa_fingerprint {};
+    if (!file_fingerprint(gfa_path, gfa_fingerprint)){
+        std::cout << "[LinkGraph::load][ERROR] could not open graph file: " << gfa_path << '\n';
+        return false;
+    }
+    return read_graph(gfa_path, gfa_fingerprint, num_threads);
+}
+
+bool LinkGraph::read_graph(const std::string& gfa_path, const FileFingerprint& gfa_fingerprint, unsigned num_threads){
+    GfaReader gfa_file;
+    if (!gfa_file.open(gfa_path, num_threads)){
+        std::cout << "[LinkGraph::load][ERROR] could not open graph file: " << gfa_path << '\n';
+        return false;
+    }
+
+    LinkGraphBuilder builder;
+    read_links(gfa_file, builder);
+    if (gfa_file.failed()){
+        return false;
+    }
+    gfa_file.close();
+    build(builder, gfa_fingerprint);
+    return true;
+}
+
+// Builds the adjacency table from the S and L lines collected by the builder, which is left empty
+// L lines may appear in any order; duplicate links between the same pair of nodes are merged
+void LinkGraph::build(LinkGraphBuilder& builder, const FileFingerprint& gfa_fingerprint){
+    cache_file.close();
+    source = gfa_fingerprint;
+    size_t num_names {builder.name_to_id.size()};
+    std::unordered_map<std::string, uint32_t>().swap(builder.name_to_id);
+    name_store.clear();
+    name_store.swap(builder.name_store);
+    name_offset_store.swap(builder.name_offsets);
+    builder.name_offsets.assign(1, 0);
+
+    // links are collected as (source, target) pairs first, then bucketed by source
+    std::vector<std::pair<uint32_t, uint32_t>> links;
+    links.swap(builder.links);
+
+    // counting sort of the links by source node
+    offset_store.assign(num_names + 1, 0);
+    for (auto it = links.begin(); it != links.end(); it++){
+        offset_store[it->first + 1]++;
+    }
+    for (size_t i{1}; i < offset_store.size(); i++){
+        offset_store[i] += offset_store[i - 1];
+    }
+    target_store.assign(links.size(), 0);
+    std::vector<uint64_t> fill(offset_store.begin(), offset_store.end() - 1);
+    for (auto it = links.begin(); it != links.end(); it++){
+        target_store[fill[it->first]++] = it->second;
+    }
+    std::vector<std::pair<uint32_t, uint32_t>>().swap(links);
+
+    // drop duplicate links in place, keeping neighbors in the order their L lines appear in the file
+    uint64_t write_pos {0};
+    for (size_t i{0}; i + 1 < offset_store.size(); i++){
+        uint64_t list_start {write_pos};
+        for (uint64_t j{offset_store[i]}; j < offset_store[i + 1]; j++){
+            auto list_begin = target_store.begin() + static_cast<std::ptrdiff_t>(list_start);
+            auto list_end = target_store.begin() + static_cast<std::ptrdiff_t>(write_pos);
+            if (std::find(list_begin, list_end, target_store[j]) == list_end){
+                target_store[write_pos++] = target_store[j];
+            }
+        }
+        offset_store[i] = list_start;
+    }
+    offset_store.back() = write_pos;
+    target_store.resize(write_pos);
+    target_store.shrink_to_fit();
+    built_symmetric = check_symmetry(offset_store.data(), target_store.data(), static_cast<uint32_t>(num_names));
+
+    order_names();
+    update_views();
+}
+
+// node IDs sorted by name, so names can be looked up with a binary search
+void LinkGraph::order_names(){
+    size_t num_names {name_offset_store.size() - 1};
+    name_order_store.resize(num_names);
+    for (size_t i{0}; i < num_names; i++){
+        name_order_store[i] = static_cast<uint32_t>(i);
+    }
+    const std::string& all_names {name_store};
+    const std::vector<uint64_t>& bounds {name_offset_store};
+    std::sort(name_order_store.begin(), name_order_store.end(), [&](uint32_t a, uint32_t b){
+        return all_names.compare(bounds[a], bounds[a + 1] - bounds[a], all_names, bounds[b], bounds[b + 1] - bounds[b]) < 0;
+    });
+}
+
+/* Writes the cache of the graph collected by the builder and maps it. Links the builder spilled to runs are merged from the
+   run files straight into the cache file, so the adjacency table is never held in memory; only the segment names and the
+   offset table are. Links are merged in the same order and with the same duplicates dropped as by build, so the cache is
+   the same as the one written after an in-memory build. A builder that spilled nothing is built in memory */
+bool LinkGraph::build_cache(LinkGraphBuilder& builder, const FileFingerprint& gfa_fingerprint, const std::string& cache_path){
+    if (builder.run_paths.empty()){
+        build(builder, gfa_fingerprint);
+        if (!write_cache(cache_path)){
+            // still usable from memory, the next run will try to write the cache again
+            std::cout << "[LinkGraph::build_cache][WARNING] could not write graph cache: " << cache_path << '\n';
+        }
+        return true;
+    }
+    if (!builder.links.empty()){
+        builder.write_run();
+    }
+    std::vector<std::pair<uint32_t, uint32_t>>().swap(builder.links);
+    if (builder.run_failed){
+        std::cout << "[LinkGraph::build_cache][ERROR] could not write sorted links next to graph cache: " << cache_path << '\n';
+        builder.remove_runs();
+        return false;
+    }
+
+    cache_file.close();
+    target_store.clear();
+    std::unordered_map<std::string, uint32_t>().swap(builder.name_to_id);
+    name_store.clear();
+    name_store.swap(builder.name_store);
+    name_offset_store.swap(builder.name_offsets);
+    builder.name_offsets.assign(1, 0);
+    order_names();
+    uint64_t num_names {name_offset_store.size() - 1};
+
+    CacheHeader header;
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.node_count = static_cast<uint32_t>(num_names);
+    header.link_count = 0;
+    header.names_size = name_store.size();
+    header.gfa = gfa_fingerprint;
+    // the position of the targets only depends on the number of nodes, so they are written as they are merged, and the
+    // header and offsets once the number of links is known
+    uint64_t targets_pos {cache_layout(header).targets};
+
+    std::string tmp_path {temp_path(cache_path)};
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()){
+        std::cout << "[LinkGraph::build_cache][ERROR] could not write graph cache: " << cache_path << '\n';
+        builder.remove_runs();
+        return false;
+    }
+    out.seekp(static_cast<std::streamoff>(targets_pos));
+
+    // every run is read through a buffer, which together take about the memory of one run
+    size_t buffer_links {std::max(builder.max_links / builder.run_paths.size(), size_t{4096})};
+    std::vector<std::unique_ptr<LinkRun>> runs;
+    std::priority_queue<RunHead, std::vector<RunHead>, std::greater<RunHead>> heads;
+    for (size_t i{0}; i < builder.run_paths.size(); i++){
+        runs.emplace_back(new LinkRun(builder.run_paths[i], buffer_links));
+        std::pair<uint32_t, uint32_t> link;
+        if (runs.back()->next(link)){
+            heads.push({link.first, link.second, i});
+        }
+    }
+
+    // the neighbors of one source at a time are collected, and written without duplicates
+    offset_store.assign(num_names + 1, 0);
+    std::vector<uint32_t> neighbors;
+    uint64_t num_links {0};
+    while (!heads.empty()){
+        uint32_t source {heads.top().source};
+        neighbors.clear();
+        while (!heads.empty() && heads.top().source == source){
+            RunHead head {heads.top()};
+            heads.pop();
+            if (std::find(neighbors.begin(), neighbors.end(), head.target) == neighbors.end()){
+                neighbors.push_back(head.target);
+            }
+            std::pair<uint32_t, uint32_t> link;
+            if (runs[head.run]->next(link)){
+                heads.push({link.first, link.second, head.run});
+            }
+        }
+        out.write(reinterpret_cast<const char*>(neighbors.data()), static_cast<std::streamsize>(neighbors.size() * sizeof(uint32_t)));
+        offset_store[source + 1] = neighbors.size();
+        num_links += neighbors.size();
+    }
+    bool runs_ok {true};
+    for (auto it = runs.begin(); it != runs.end(); it++){
+        runs_ok = runs_ok && !(*it)->failed();
+    }
+    runs.clear();
+    builder.remove_runs();
+    for (size_t i{1}; i < offset_store.size(); i++){
+        offset_store[i] += offset_store[i - 1];
+    }
+
+    // symmetry is checked once on the targets written so far, so they are never held in memory
+    MappedFile written_targets;
+    out.flush();
+    header.symmetric = num_links == 0 || (out.good() && written_targets.open(tmp_path) && written_targets.size() >= targets_pos + num_links * sizeof(uint32_t) &&
+        check_symmetry(offset_store.data(), reinterpret_cast<const uint32_t*>(written_targets.data() + targets_pos), static_cast<uint32_t>(num_names)));
+    written_targets.close();
+
+    header.link_count = num_links;
+    const char zeros[8] {};
+    out.write(zeros, static_cast<std::streamsize>(pad8(num_links * sizeof(uint32_t)) - num_links * sizeof(uint32_t)));
+    write_padded(out, name_offset_store.data(), (num_names + 1) * sizeof(uint64_t));
+    write_padded(out, name_order_store.data(), num_names * sizeof(uint32_t));
+    write_padded(out, name_store.data(), header.names_size);
+    out.seekp(0);
+    write_padded(out, &header, sizeof(CacheHeader));
+    write_padded(out, offset_store.data(), (num_names + 1) * sizeof(uint64_t));
+    out.close();
+
+    // the tables now live in the cache file
+    built_symmetric = true;
+    offset_store.assign(1, 0);
+    offset_store.shrink_to_fit();
+    name_offset_store.assign(1, 0);
+    name_offset_store.shrink_to_fit();
+    std::vector<uint32_t>().swap(name_order_store);
+    std::string().swap(name_store);
+    if (out.fail() || !runs_ok || std::rename(tmp_path.c_str(), cache_path.c_str()) != 0){
+        std::cout << "[LinkGraph::build_cache][ERROR] could not write graph cache: " << cache_path << '\n';
+        std::remove(tmp_path.c_str());
+        update_views();
+        return false;
+    }
+    source = gfa_fingerprint;
+    if (!map_cache(cache_path, "", source)){
+        std::cout << "[LinkGraph::build_cache][ERROR] could not map graph cache: " << cache_path << '\n';
+        return false;
+    }
+    return true;
+}
+
+/* Maps the binary cache if it was built from the same .gfa file, otherwise parses the .gfa file and rewrites the cache. The
+   cache is matched to the file by its size, modification time and inode, so a cache hit does not read the file; the file is
+   only hashed when these changed (e.g., it was touched or copied), or once before the cache is rebuilt, so that the new
+   cache can be matched by its contents later */
+bool LinkGraph::load_cached(const std::string& gfa_path, const std::string& cache_path, unsigned num_threads, uint64_t memory_budget){
+    FileFingerprint gfa_fingerprint {};
+    if (!file_fingerprint(gfa_path, gfa_fingerprint)){
+        std::cout << "[LinkGraph::load_cached][ERROR] could not open graph file: " << gfa_path << '\n';
+        return false;
+    }
+
+    if (map_cache(cache_path, gfa_path, gfa_fingerprint)){
+        return true;
+    }
+
+    uint64_t gfa_size;
+    if (gfa_fingerprint.checksum == 0 && !file_checksum(gfa_path, gfa_size, gfa_fingerprint.checksum)){
+        std::cout << "[LinkGraph::load_cached][ERROR] could not read graph file: " << gfa_path << '\n';
+        return false;
+    }
+
+    std::cout << "[LinkGraph::load_cached] building graph cache " << cache_path << '\n';
+    if (memory_budget > 0){
+        GfaReader gfa_file;
+        if (!gfa_file.open(gfa_path, num_threads)){
+            std::cout << "[LinkGraph::load_cached][ERROR] could not open graph file: " << gfa_path << '\n';
+            return false;
+        }
+        LinkGraphBuilder builder;
+        builder.spill_links(cache_path, memory_budget);
+        read_links(gfa_file, builder);
+        if (gfa_file.failed()){
+            return false;
+        }
+        gfa_file.close();
+        return build_cache(builder, gfa_fingerprint, cache_path);
+    }
+    if (!read_graph(gfa_path, gfa_fingerprint, num_threads)){
+        return false;
+    }
+    if (!write_cache(cache_path)){
+        // still usable from memory, the next run will try to write the cache again
+        std::cout << "[LinkGraph::load_cached][WARNING] could not write graph cache: " << cache_path << '\n';
+    }
+    return true;
+}
+
+// a cache that was just written is mapped with its own fingerprint, and gfa_path is not read
+bool LinkGraph::map_cache(const std::string& cache_path, const std::string& gfa_path, FileFingerprint& gfa_fingerprint){
+    if (!cache_file.open(cache_path)){
+        return false;
+    }
+
+    bool valid {false};
+    CacheHeader header;
+    if (cache_file.size() < sizeof(CacheHeader)){
+        std::cout << "[LinkGraph::map_cache] graph cache is truncated\n";
+    }else{
+        std::memcpy(&header, cache_file.data(), sizeof(CacheHeader));
+        if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 || header.version != cache_version){
+            std::cout << "[LinkGraph::map_cache] graph cache has an unsupported format version\n";
+        }else if (!same_contents(gfa_path, gfa_fingerprint, header.gfa)){
+            std::cout << "[LinkGraph::map_cache] graph cache was built from a different graph file\n";
+        }else if (cache_file.size() != cache_layout(header).total){
+            std::cout << "[LinkGraph::map_cache] graph cache is truncated\n";
+        }else{
+            valid = true;
+        }
+    }
+
+    if (!valid){
+        cache_file.close();
+    }
+    update_views();
+    return valid;
+}
+
+bool LinkGraph::write_cache(const std::string& cache_path) const{
+    CacheHeader header;
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.node_count = node_count;
+    header.link_count = link_count;
+    header.names_size = name_offsets[node_count];
+    header.symmetric = symmetric;
+    header.gfa = source;
+
+    // write to a temporary file first so an interrupted run never leaves a truncated cache behind
+    std::string tmp_path {temp_path(cache_path)};
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()){
+        return false;
+    }
+    write_padded(out, &header, sizeof(CacheHeader));
+    write_padded(out, offsets, (node_count + uint64_t{1}) * sizeof(uint64_t));
+    write_padded(out, targets, link_count * sizeof(uint32_t));
+    write_padded(out, name_offsets, (node_count + uint64_t{1}) * sizeof(uint64_t));
+    write_padded(out, name_order, node_count * sizeof(uint32_t));
+    write_padded(out, names, header.names_size);
+    out.close();
+    if (out.fail()){
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return std::rename(tmp_path.c_str(), cache_path.c_str()) == 0;
+}
+
+bool LinkGraph::is_mapped() const{
+    return cache_file.data() != nullptr;
+}
+
+// Points the table views at the cache mapping if one is open, otherwise at the tables built in memory
+void LinkGraph::update_views(){
+    if (is_mapped()){
+        CacheHeader header;
+        std::memcpy(&header, cache_file.data(), sizeof(CacheHeader));
+        CacheLayout layout {cache_layout(header)};
+        const char* base {cache_file.data()};
+        node_count = header.node_count;
+        link_count = header.link_count;
+        offsets = reinterpret_cast<const uint64_t*>(base + layout.offsets);
+        targets = reinterpret_cast<const uint32_t*>(base + layout.targets);
+        name_offsets = reinterpret_cast<const uint64_t*>(base + layout.name_offsets);
+        name_order = reinterpret_cast<const uint32_t*>(base + layout.name_order);
+        names = base + layout.names;
+        symmetric = header.symmetric != 0;
+        return;
+    }
+    node_count = static_cast<uint32_t>(offset_store.size() - 1);
+    link_count = target_store.size();
+    offsets = offset_store.data();
+    targets = target_store.data();
+    name_offsets = name_offset_store.data();
+    name_order = name_order_store.data();
+    names = name_store.data();
+    symmetric = built_symmetric;
+}
+
+bool LinkGraph::get_id(const std::string& name, uint32_t& id) const{
+    const uint32_t* found {std::lower_bound(name_order, name_order + node_count, name, [&](uint32_t a, const std::string& key){
+        return compare_name(names + name_offsets[a], names + name_offsets[a + 1], key) < 0;
+    })};
+    if (found == name_order + node_count || compare_name(names + name_offsets[*found], names + name_offsets[*found + 1], name) != 0){
+        return false;
+    }
+    id = *found;
+    return true;
+}
+
+std::string LinkGraph::get_name(uint32_t id) const{
+    return std::string(names + name_offsets[id], names + name_offsets[id + 1]);
+}
+
+uint32_t LinkGraph::num_nodes() const{
+    return node_count;
+}
+
+uint64_t LinkGraph::num_links() const{
+    return link_count;
+}
+
+const uint32_t* LinkGraph::neighbors_begin(uint32_t id) const{
+    return targets + offsets[id];
+}
+
+const uint32_t* LinkGraph::neighbors_end(uint32_t id) const{
+    return targets + offsets[id + 1];
+}
+
+uint32_t LinkGraph::degree(uint32_t id) const{
+    return static_cast<uint32_t>(offsets[id + 1] - offsets[id]);
+}
+
+// True if every link u -> v has a matching link v -> u, as checked when the graph was built
+bool LinkGraph::is_symmetric() const{
+    return symmetric;
+}
+
+void LinkGraph::set_prefetch(bool prefetch){
+    this->prefetch = prefetch;
+}
+
+void LinkGraph::prefetch_neighbors(const uint32_t* begin, const uint32_t* end, std::vector<std::pair<uint64_t, uint64_t>>& ranges) const{
+    // a single lookup would wait for its read anyway
+    if (!prefetch || !is_mapped() || end - begin < 2){
+        return;
+    }
+    uint64_t targets_pos {static_cast<uint64_t>(reinterpret_cast<const char*>(targets) - cache_file.data())};
+    ranges.clear();
+    for (const uint32_t* it = begin; it != end; it++){
+        if (offsets[*it] < offsets[*it + 1]){
+            ranges.push_back({targets_pos + offsets[*it] * sizeof(uint32_t), targets_pos + offsets[*it + 1] * sizeof(uint32_t)});
+        }
+    }
+    std::sort(ranges.begin(), ranges.end());
+
+    // lists separated by less than a few pages are read together, since reading the gap costs less than another request
+    const uint64_t max_gap {16 * 1024};
+    size_t i {0};
+    while (i < ranges.size()){
+        uint64_t start {ranges[i].first};
+        uint64_t stop {ranges[i].second};
+        for (i++; i < ranges.size() && ranges[i].first <= stop + max_gap; i++){
+            stop = std::max(stop, ranges[i].second);
+        }
+        cache_file.will_need(static_cast<size_t>(start), static_cast<size_t>(stop - start));
+    }
+}
+
+// Number of bytes taken up by the graph tables, whether built in memory or mapped from the cache
+size_t LinkGraph::memory_usage() const{
+    uint64_t total {(node_count + uint64_t{1}) * sizeof(uint64_t) * 2};
+    total += link_count * sizeof(uint32_t);
+    total += node_count * sizeof(uint32_t);
+    total += name_offsets[node_count];
+    return static_cast<size_t>(total);
+}
+
+// Fingerprint of a file's contents, used to tell whether a graph cache still matches its .gfa file
+// every byte is hashed, so any edit is noticed; 64-bit words are hashed FNV-1a style on four independent lanes so that
+// hashing keeps up with reading the file, and since each step is a bijection of the lane, changing one word always
+// changes the fingerprint
+bool file_checksum(const std::string& path, uint64_t& file_size, uint64_t& checksum){
+    std::ifstream in_file(path, std::ios::binary);
+    if (!in_file.is_open()){
+        return false;
+    }
+
+    const uint64_t basis {14695981039346656037ULL};
+    const uint64_t prime {1099511628211ULL};
+    const size_t num_lanes {4};
+    uint64_t lanes[num_lanes] {basis, basis ^ 1, basis ^ 2, basis ^ 3};
+    // the buffer holds whole groups of one word per lane, so only the end of the file leaves bytes over
+    std::vector<char> buffer(size_t{1} << 20);
+    const size_t group_size {num_lanes * sizeof(uint64_t)};
+    file_size = 0;
+    uint64_t tail {basis};
+    while (in_file){
+        in_file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        size_t length {static_cast<size_t>(in_file.gcount())};
+        file_size += length;
+        size_t grouped {length / group_size * group_size};
+        for (size_t pos{0}; pos < grouped; pos += group_size){
+            for (size_t lane{0}; lane < num_lanes; lane++){
+                uint64_t word;
+                std::memcpy(&word, buffer.data() + pos + lane * sizeof(uint64_t), sizeof(word));
+                lanes[lane] = (lanes[lane] ^ word) * prime;
+            }
+        }
+        for (size_t pos{grouped}; pos < length; pos++){
+            tail = (tail ^ static_cast<unsigned char>(buffer[pos])) * prime;
+        }
+    }
+    if (in_file.bad()){
+        return false;
+    }
+
+    // fold the lanes, the bytes past the last group and the size into one value
+    uint64_t hash {basis};
+    for (uint64_t value : {lanes[0], lanes[1], lanes[2], lanes[3], tail, file_size}){
+        hash = (hash ^ value) * prime;
+        hash ^= hash >> 29;
+    }
+    // 0 stands for a checksum that was not computed
+    checksum = hash == 0 ? 1 : hash;
+    return true;
+}
+
+bool file_fingerprint(const std::string& path, FileFingerprint& fingerprint){
+    struct stat file_stat;
+    if (stat(path.c_str(), &file_stat) != 0){
+        return false;
+    }
+    fingerprint.size = static_cast<uint64_t>(file_stat.st_size);
+#ifdef __APPLE__
+    fingerprint.modified_sec = static_cast<uint64_t>(file_stat.st_mtimespec.tv_sec);
+    fingerprint.modified_nsec = static_cast<uint64_t>(file_stat.st_mtimespec.tv_nsec);
+#else
+    fingerprint.modified_sec = static_cast<uint64_t>(file_stat.st_mtim.tv_sec);
+    fingerprint.modified_nsec = static_cast<uint64_t>(file_stat.st_mtim.tv_nsec);
+#endif
+    fingerprint.inode = static_cast<uint64_t>(file_stat.st_ino);
+    fingerprint.checksum = 0;
+    return true;
+}
+
+bool same_contents(const std::string& path, FileFingerprint& current, const FileFingerprint& stored){
+    if (current.size != stored.size){
+        return false;
+    }
+    if (current.modified_sec == stored.modified_sec && current.modified_nsec == stored.modified_nsec && current.inode == stored.inode){
+        return true;
+    }
+    // the file was touched, rewritten or copied since; it still counts as the same file if its contents hash the same
+    if (stored.checksum == 0){
+        return false;
+    }
+    uint64_t file_size;
+    if (current.checksum == 0 && !file_checksum(path, file_size, current.checksum)){
+        return false;
+    }
+    return current.checksum == stored.checksum;
+}
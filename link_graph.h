@@ -0,0 +1,135 @@
+#ifndef LINK_GRAPH_H
+#define LINK_GRAPH_H
+
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Identifies the contents of a graph file for the files built from it; the size, modification time and inode come from one
+// stat call, and the checksum of the contents is only computed when they have changed (0 if it was not computed)
+struct FileFingerprint{
+	uint64_t size;
+	uint64_t modified_sec;
+	uint64_t modified_nsec;
+	uint64_t inode;
+	uint64_t checksum;
+};
+
+// Collects the S and L lines of a .gfa file in file order, assigning node IDs in order of first appearance,
+// for LinkGraph::build; lets the graph be built while the file is read for other purposes
+class LinkGraphBuilder{
+	public:
+		LinkGraphBuilder();
+		~LinkGraphBuilder();
+		LinkGraphBuilder(const LinkGraphBuilder&) = delete;
+		LinkGraphBuilder& operator=(const LinkGraphBuilder&) = delete;
+
+		// returns the node ID of the segment
+		uint32_t add_segment(const char* name, size_t size);
+		void add_link(const char* source, size_t source_size, const char* target, size_t target_size);
+		// keeps at most memory_budget bytes of links in memory: once they fill it, they are sorted by source and written to a
+		// run file named after run_prefix, for LinkGraph::build_cache to merge; the segment names are still kept in memory
+		void spill_links(const std::string& run_prefix, uint64_t memory_budget);
+
+	private:
+		friend class LinkGraph;
+		uint32_t intern(const char* name, size_t size);
+		void write_run();
+		void remove_runs();
+
+		std::unordered_map<std::string, uint32_t> name_to_id;
+		std::string lookup_key;
+		std::string name_store;
+		std::vector<uint64_t> name_offsets;
+		std::vector<std::pair<uint32_t, uint32_t>> links;
+
+		// runs of links sorted by source, in file order
+		std::string run_prefix;
+		size_t max_links;
+		std::vector<std::string> run_paths;
+		bool run_failed;
+};
+
+// Adjacency of the assembly graph in compressed sparse row form
+// node IDs are assigned in order of first appearance in the .gfa file
+// the tables either live in memory or are mapped from a binary cache file written by an earlier run
+class LinkGraph{
+	public:
+		LinkGraph();
+		LinkGraph(const LinkGraph&) = delete;
+		LinkGraph& operator=(const LinkGraph&) = delete;
+
+		// the .gfa file may be gzip-compressed; BGZF files are decompressed on num_threads threads
+		bool load(const std::string& gfa_path, unsigned num_threads);
+		void build(LinkGraphBuilder& builder, const FileFingerprint& gfa_fingerprint);
+		// with a memory budget (in bytes), a missing cache is built out of core: the links are sorted in runs that fit into the
+		// budget and merged into the cache file, which is then mapped, so graphs with more links than fit in memory can be used
+		bool load_cached(const std::string& gfa_path, const std::string& cache_path, unsigned num_threads, uint64_t memory_budget = 0);
+		// writes the cache of the graph collected by the builder, merging the runs it spilled, and maps it
+		bool build_cache(LinkGraphBuilder& builder, const FileFingerprint& gfa_fingerprint, const std::string& cache_path);
+		bool write_cache(const std::string& cache_path) const;
+		bool is_mapped() const;
+
+		bool get_id(const std::string& name, uint32_t& id) const;
+		std::string get_name(uint32_t id) const;
+		uint32_t num_nodes() const;
+		uint64_t num_links() const;
+
+		// neighbors of node id are stored in [neighbors_begin(id), neighbors_end(id))
+		const uint32_t* neighbors_begin(uint32_t id) const;
+		const uint32_t* neighbors_end(uint32_t id) const;
+		uint32_t degree(uint32_t id) const;
+		// true if every link u -> v is matched by a link v -> u, so that searches may follow links backwards; checked once when
+		// the graph is built and saved in the cache
+		bool is_symmetric() const;
+
+		// with prefetching on and the graph mapped, prefetch_neighbors asks the kernel to read the neighbor lists of a batch of
+		// nodes ahead of their lookups, joining lists that lie close together in the cache into one read
+		void set_prefetch(bool prefetch);
+		void prefetch_neighbors(const uint32_t* begin, const uint32_t* end, std::vector<std::pair<uint64_t, uint64_t>>& ranges) const;
+
+		size_t memory_usage() const;
+
+	private:
+		bool read_graph(const std::string& gfa_path, const FileFingerprint& gfa_fingerprint, unsigned num_threads);
+		bool map_cache(const std::string& cache_path, const std::string& gfa_path, FileFingerprint& gfa_fingerprint);
+		void order_names();
+		void update_views();
+
+		// tables built from the .gfa file
+		std::vector<uint64_t> offset_store;
+		std::vector<uint32_t> target_store;
+		std::vector<uint64_t> name_offset_store;
+		std::vector<uint32_t> name_order_store;
+		std::string name_store;
+		FileFingerprint source;
+		bool built_symmetric;
+
+		// tables mapped from the cache file
+		MappedFile cache_file;
+		bool prefetch;
+
+		// views of whichever tables are in use
+		uint32_t node_count;
+		uint64_t link_count;
+		const uint64_t* offsets;
+		const uint32_t* targets;
+		const uint64_t* name_offsets;
+		const uint32_t* name_order;
+		const char* names;
+		bool symmetric;
+};
+
+bool file_checksum(const std::string& path, uint64_t& file_size, uint64_t& checksum);
+// reads the size, modification time and inode of a file, leaving its checksum at 0
+bool file_fingerprint(const std::string& path, FileFingerprint& fingerprint);
+// true if the file fingerprinted as current still holds the contents fingerprinted as stored: its size, modification time and
+// inode are unchanged, or only its size is and its checksum matches, in which case the checksum is computed into current
+bool same_contents(const std::string& path, FileFingerprint& current, const FileFingerprint& stored);
+
+#endif
@@ -1,15 +1,176 @@
 #include "argument_parser.h"
+#include "batch.h"
+#include "link_graph.h"
+#include "paf_store.h"
 #include "preprocess.h"
+#include "region_mask.h"
+#include "run_metrics.h"
+#include "sv_extract.h"
 #include "topology_search.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <iterator>
 #include <fstream>
 #include <map>
 #include <stdlib.h>
-#include <sys/stat.h>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace{
+    bool write_calls(ArgumentParser& input, const RegionMask& mask, const PafStore& alignments, const std::unordered_map<std::string, size_t>& final_svs, const std::string& prefix, RunMetrics& metrics);
+
+    // Topology search and SV extraction of call and run, once the graph and the tumor-only unitigs are loaded
+    bool call_svs(ArgumentParser& input, const RegionMask& mask, LinkGraph& graph, const std::vector<bool>& all_tumor_utgs, const std::string& prefix, RunMetrics& metrics){
+        // the alignments are indexed once, and every later stage looks up their records in the same index
+        StageMetrics& split_stage {metrics.begin_stage("split_alignments")};
+        PafStore alignments;
+        if (!alignments.open(input.args["-o"] + "/intermediate_output/tumor_only_unitigs_mapq_filtered.paf")){
+            return false;
+        }
+        std::unordered_set<std::string> candidate_utgs;
+        if (!topology_search::get_split_alignments(alignments, candidate_utgs, split_stage)){
+            return false;
+        }
+
+        std::cout << prefix << " number of candidate unitigs before topology search: " << candidate_utgs.size() << '\n';
+
+        // candidates whose alignments are all masked would only yield calls removed by the region filter
+        std::unordered_set<std::string> masked_utgs;
+        if (input.args["--prune-masked"] == "yes"){
+            StageMetrics& stage {metrics.begin_stage("masked_candidates")};
+            if (!topology_search::find_masked_candidates(alignments, mask, candidate_utgs, masked_utgs)){
+                return false;
+            }
+            stage.add_count("masked_candidates", masked_utgs.size());
+            std::cout << prefix << " skipping " << masked_utgs.size() << " candidate unitigs with all alignments in masked regions\n";
+        }
+
+        std::cout << prefix << " running topology search\n";
+
+        // number of k values (smallest first) each remaining unitig passed the search for
+        std::unordered_map<std::string, size_t> final_svs;
+        if (!topology_search::run_topology_search(input, graph, all_tumor_utgs, candidate_utgs, masked_utgs, final_svs, metrics.begin_stage("topology_search"))){
+            return false;
+        }
+
+        // a shard only searches its slice of the candidates; colorSV merge writes the calls once every shard is done
+        if (input.args.count("--shard") > 0){
+            std::cout << prefix << " saved the results of shard " << input.args["--shard"] << ", run colorSV merge once every shard is done\n";
+            return true;
+        }
+        return write_calls(input, mask, alignments, final_svs, prefix, metrics);
+    }
+
+    // Candidate alignments and call sets of the unitigs that passed the topology search
+    bool write_calls(ArgumentParser& input, const RegionMask& mask, const PafStore& alignments, const std::unordered_map<std::string, size_t>& final_svs, const std::string& prefix, RunMetrics& metrics){
+        std::vector<int> ks {topology_search::k_values(input)};
+        if (ks.size() == 1){
+            std::cout << prefix << " number of unitigs that pass all filters: " << final_svs.size() << '\n';
+        }else{
+            for (size_t i{0}; i < ks.size(); i++){
+                size_t num_passed {0};
+                for (auto it = final_svs.begin(); it != final_svs.end(); it++){
+                    num_passed += it->second > i;
+                }
+                std::cout << prefix << " number of unitigs that pass all filters with k=" << ks[i] << ": " << num_passed << '\n';
+            }
+        }
+        if (!topology_search::write_final_paf(input, alignments, final_svs, metrics.begin_stage("final_paf"))){
+            return false;
+        }
+
+        std::cout << prefix << " extracting SVs from candidate alignments\n";
+
+        // extract long INDELs and breakpoints
+        if (!sv_extract::extract_svs(input, mask, final_svs, metrics.begin_stage("extraction"))){
+            return false;
+        }
+
+        return true;
+    }
+
+    /* Preprocess and call in one go, reading the graph file only once */
+    bool run_command(ArgumentParser& input, RunMetrics& metrics){
+        if (!preprocess::check_args(input) || !topology_search::check_args(input)){
+            return false;
+        }
+        if (!preprocess::file_setup(input)){
+            return false;
+        }
+
+        RegionMask mask;
+        if (!mask.load(input.args["--filter"])){
+            std::cout << "[run][ERROR] could not open mask/filtering file: " << input.args["--filter"] << '\n';
+            return false;
+        }
+
+        std::cout << "[run] filtering unitigs to only keep tumor-only and loading links from assembly graph\n";
+
+        // with --pipeline yes, the unitigs are aligned while the graph is scanned and the graph cache is written
+        bool pipelined {input.args["--pipeline"] == "yes"};
+        AlignmentPipeline pipeline;
+        if (pipelined && !pipeline.start(input)){
+            return false;
+        }
+
+        LinkGraph graph;
+        std::vector<bool> all_tumor_utgs;
+        if (!preprocess::filter_unitigs(input, &graph, &all_tumor_utgs, pipelined ? &pipeline : nullptr, metrics.begin_stage("gfa_filter"))){
+            return false;
+        }
+
+        std::cout << "[run] assembly graph has " << graph.num_nodes() << " unitigs and " << graph.num_links() << " links (" << static_cast<double>(graph.memory_usage()) / (1024*1024) << " MB, " << (graph.is_mapped() ? "mapped from graph cache" : "in memory") << ")\n";
+        graph.set_prefetch(graph.is_mapped());
+
+        // later call runs on this output directory can map the graph instead of parsing it again
+        StageMetrics& graph_stage {metrics.begin_stage("link_graph")};
+        graph_stage.add_count("unitigs", graph.num_nodes());
+        graph_stage.add_count("links", graph.num_links());
+        std::string cache_path {input.args["-o"] + "/intermediate_output/link_graph.bin"};
+        // a graph built within --link-memory was written to the cache as it was built
+        if (!graph.is_mapped() && !graph.write_cache(cache_path)){
+            std::cout << "[run][WARNING] could not write graph cache: " << cache_path << '\n';
+        }
+
+        std::cout << (pipelined ? "[run] finishing unitig alignment\n" : "[run] performing unitig alignment\n");
+
+        StageMetrics& align_stage {metrics.begin_stage("alignment")};
+        if (pipelined ? !pipeline.finish(align_stage) : !preprocess::align_unitigs(input, align_stage)){
+            return false;
+        }
+
+        if (!call_svs(input, mask, graph, all_tumor_utgs, "[run]", metrics)){
+            return false;
+        }
+
+        return true;
+    }
+
+    // metrics of the command and its arguments are kept in the output directory; the shards of a call keep their own metrics
+    void save_run_record(ArgumentParser& input, RunMetrics& metrics){
+        std::string metrics_name {"metrics.json"};
+        size_t shard, num_shards;
+        if (input.args.count("--shard") > 0 && topology_search::parse_shard(input.args["--shard"], shard, num_shards)){
+            metrics_name = "metrics.shard_" + std::to_string(shard + 1) + "_of_" + std::to_string(num_shards) + ".json";
+        }
+        if (!metrics.write(input.args["-o"] + "/" + metrics_name)){
+            std::cout << "[" << input.args["command"] << "][WARNING] could not write " << input.args["-o"] << "/" << metrics_name << '\n';
+        }
+        std::ofstream cmd_file(input.args["-o"] + "/command.txt", std::ios_base::app);
+
+        std::cout << "*************************\n";
+        cmd_file << "*************************\n";
+        std::map<std::string, std::string> :: iterator it;
+        for (it=input.args.begin();it !=input.args.end();++it){
+            std::cout << it->first << ' ' <<it->second << '\n';
+            cmd_file << it->first << ' ' <<it->second << '\n';
+        }
+        cmd_file.close();
+    }
+}
 
 int main(int argc, char* argv[]){
     ArgumentParser input(argc, argv);
@@ -18,6 +179,8 @@ int main(int argc, char* argv[]){
         print_help();
         return 0;
     }
+    // wall time, CPU time, memory and record counts of each stage, saved to metrics.json in the output directory
+    RunMetrics metrics(input.args["command"]);
 
     if (input.args["command"] == "preprocess"){
         // check that the user input all required flags
@@ -30,15 +193,26 @@ int main(int argc, char* argv[]){
             return 1;
         }
 
-        std::cout << "[preprocess] filtering unitigs to only keep tumor-only\n";
+        // with --from-support-table yes, the support saved by an earlier scan of the graph is read instead of the graph
+        bool from_table {input.args["--from-support-table"] == "yes"};
+        std::cout << (from_table ? "[preprocess] filtering unitigs to only keep tumor-only, using support table " + input.args["--support-table"] + "\n" : "[preprocess] filtering unitigs to only keep tumor-only\n");
 
-        if (!preprocess::filter_unitigs(input)){
+        // with --pipeline yes, the unitigs are aligned while the graph is scanned
+        bool pipelined {input.args["--pipeline"] == "yes"};
+        AlignmentPipeline pipeline;
+        if (pipelined && !pipeline.start(input)){
             return 1;
         }
 
-        std::cout << "[preprocess] performing unitig alignment\n";
+        StageMetrics& filter_stage {metrics.begin_stage("gfa_filter")};
+        if (from_table ? !preprocess::filter_unitigs_from_table(input, pipelined ? &pipeline : nullptr, filter_stage) : !preprocess::filter_unitigs(input, nullptr, nullptr, pipelined ? &pipeline : nullptr, filter_stage)){
+            return 1;
+        }
+
+        std::cout << (pipelined ? "[preprocess] finishing unitig alignment\n" : "[preprocess] performing unitig alignment\n");
 
-        if(!preprocess::align_unitigs(input)){
+        StageMetrics& align_stage {metrics.begin_stage("alignment")};
+        if (pipelined ? !pipeline.finish(align_stage) : !preprocess::align_unitigs(input, align_stage)){
             return 1;
         }
     }else if (input.args["command"] == "call"){
@@ -46,65 +220,84 @@ int main(int argc, char* argv[]){
             return 1;
         }
 
-        std::unordered_map<int, std::streampos> link_index;
-        if (!topology_search::index_link_file(input, link_index)){
+        RegionMask mask;
+        if (!mask.load(input.args["--filter"])){
+            std::cout << "[call][ERROR] could not open mask/filtering file: " << input.args["--filter"] << '\n';
             return 1;
         }
 
-        std::unordered_set<std::string> candidate_utgs;
-        if (!topology_search::get_split_alignments(input, candidate_utgs)){
+        std::cout << "[call] loading links from assembly graph\n";
+
+        StageMetrics& graph_stage {metrics.begin_stage("link_graph")};
+        std::string cache_path {input.args["-o"] + "/intermediate_output/link_graph.bin"};
+        LinkGraph graph;
+        uint64_t link_memory {std::stoull(input.args["--link-memory"]) << 20};
+        if (!graph.load_cached(input.args["--graph"], cache_path, static_cast<unsigned>(std::stoi(input.args["-t"])), link_memory)){
             return 1;
         }
+        // a graph too large to build in memory is likely too large for the page cache, so searches read its lists ahead
+        graph.set_prefetch(link_memory > 0);
 
-        std::cout << "[call] number of candidate unitigs before topology search: " << candidate_utgs.size() << '\n';
+        std::cout << "[call] assembly graph has " << graph.num_nodes() << " unitigs and " << graph.num_links() << " links (" << static_cast<double>(graph.memory_usage()) / (1024*1024) << " MB, " << (graph.is_mapped() ? "mapped from graph cache" : "in memory") << ")\n";
 
-        std::cout << "[call] running topology search... if this is too slow, consider decreasing the value of --index-bin-size\n";
+        // get set of all tumor-only unitigs, since they will be excluded from the topology search
+        std::string utg_path {input.args["-o"] + "/intermediate_output/all_tumor_only_unitigs.txt"};
+        std::vector<bool> all_tumor_utgs {topology_search::load_tumor_unitigs(utg_path, graph)};
 
-        std::unordered_set<std::string> final_svs;
-        if (!topology_search::run_topology_search(input, link_index, candidate_utgs, final_svs)){
+        graph_stage.bytes_read = run_metrics::file_size(graph.is_mapped() ? cache_path : input.args["--graph"]) + run_metrics::file_size(utg_path);
+        graph_stage.add_count("unitigs", graph.num_nodes());
+        graph_stage.add_count("links", graph.num_links());
+        graph_stage.add_count("from_cache", graph.is_mapped());
+        graph_stage.add_count("tumor_only_unitigs", static_cast<uint64_t>(std::count(all_tumor_utgs.begin(), all_tumor_utgs.end(), true)));
+
+        if (!call_svs(input, mask, graph, all_tumor_utgs, "[call]", metrics)){
             return 1;
         }
-
-        std::cout << "[call] number of unitigs that pass all filters: " << final_svs.size() << '\n';
-        if (!topology_search::write_final_paf(input, final_svs)){
+    }else if (input.args["command"] == "merge"){
+        if (!topology_search::check_args(input)){
             return 1;
         }
 
-        std::string cmd;
-        struct stat buffer;   
-        // check for gafcall script in colorSV directory first, then $PATH
-        if (stat((input.args["exe_path"] + "gafcall.js").c_str(), &buffer) == 0){
-            cmd  = input.args["exe_path"] + "gafcall.js";
-        }else{
-            cmd = "gafcall.js";
+        RegionMask mask;
+        if (!mask.load(input.args["--filter"])){
+            std::cout << "[merge][ERROR] could not open mask/filtering file: " << input.args["--filter"] << '\n';
+            return 1;
         }
-        // extract long INDELs and breakpoints
-        cmd += " extract -q " + input.args["-q"] + " -Q " + input.args["-Q"] + " -b " + input.args["--filter"] + ' ' + input.args["-o"] + "/intermediate_output/candidate_svs_without_mask.paf > " + input.args["-o"] + "/sv_calls.sv";
-        system(cmd.c_str());
-
-        // extract translocations
-        cmd = "awk '$3~/[><]/&&$1!=$4' " + input.args["-o"] + "/sv_calls.sv > " + input.args["-o"] + "/translocations.sv";
-        system(cmd.c_str());
-
-        // remove centromere regions
-        cmd = "awk '! /cen_dist=0;/' " +    input.args["-o"] + "/sv_calls.sv > " + input.args["-o"] + "/sv_calls_region_filtered.sv";
-        system(cmd.c_str());
 
-        cmd = "awk '! /cen_dist=0;/' " +    input.args["-o"] + "/translocations.sv > " + input.args["-o"] + "/translocations_region_filtered.sv";
-        system(cmd.c_str());
+        std::cout << "[merge] merging topology search results of " << input.args["--shards"] << " shards\n";
 
+        PafStore alignments;
+        if (!alignments.open(input.args["-o"] + "/intermediate_output/tumor_only_unitigs_mapq_filtered.paf")){
+            return 1;
+        }
+        std::unordered_map<std::string, size_t> final_svs;
+        if (!topology_search::merge_shards(input, final_svs, metrics.begin_stage("topology_search"))){
+            return 1;
+        }
+        if (!write_calls(input, mask, alignments, final_svs, "[merge]", metrics)){
+            return 1;
+        }
+    }else if (input.args["command"] == "run"){
+        if (!run_command(input, metrics)){
+            return 1;
+        }
+    }else if (input.args["command"] == "batch"){
+        // every entry runs in its own process and saves its own metrics and arguments
+        if (!batch::check_args(input)){
+            return 1;
+        }
+        bool ok {batch::run_batch(input, [](ArgumentParser& entry_args){
+            RunMetrics entry_metrics(entry_args.args["command"]);
+            if (!run_command(entry_args, entry_metrics)){
+                return false;
+            }
+            save_run_record(entry_args, entry_metrics);
+            return true;
+        })};
+        return ok ? 0 : 1;
     }else{
         std::cout << "Undefined command\n";
     }
-    std::ofstream cmd_file(input.args["-o"] + "/command.txt", std::ios_base::app);
-
-    std::cout << "*************************\n";
-    cmd_file << "*************************\n";
-    std::map<std::string, std::string> :: iterator it;
-    for (it=input.args.begin();it !=input.args.end();++it){
-        std::cout << it->first << ' ' <<it->second << '\n';
-        cmd_file << it->first << ' ' <<it->second << '\n';
-    }
-    cmd_file.close();
+    save_run_record(input, metrics);
     return 0;
 }
@@ -0,0 +1,70 @@
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile() : map_start(nullptr), map_size(0){}
+
+MappedFile::~MappedFile(){
+    close();
+}
+
+bool MappedFile::open(const std::string& path){
+    close();
+
+    int fd {::open(path.c_str(), O_RDONLY)};
+    if (fd < 0){
+        return false;
+    }
+
+    struct stat buffer;
+    if (fstat(fd, &buffer) != 0){
+        ::close(fd);
+        return false;
+    }
+    map_size = static_cast<size_t>(buffer.st_size);
+
+    // empty files cannot be mapped, but are still valid input
+    if (map_size > 0){
+        void* start {mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0)};
+        if (start == MAP_FAILED){
+            ::close(fd);
+            map_size = 0;
+            return false;
+        }
+        map_start = static_cast<const char*>(start);
+    }
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::close(){
+    if (map_start != nullptr){
+        munmap(const_cast<char*>(map_start), map_size);
+    }
+    map_start = nullptr;
+    map_size = 0;
+}
+
+const char* MappedFile::data() const{
+    return map_start;
+}
+
+size_t MappedFile::size() const{
+    return map_size;
+}
+
+void MappedFile::will_need(size_t offset, size_t length) const{
+    if (map_start == nullptr || offset >= map_size){
+        return;
+    }
+    // madvise needs a page-aligned start
+    size_t page_size {static_cast<size_t>(sysconf(_SC_PAGESIZE))};
+    size_t start {offset / page_size * page_size};
+    size_t end {std::min(offset + length, map_size)};
+    madvise(const_cast<char*>(map_start) + start, end - start, MADV_WILLNEED);
+}
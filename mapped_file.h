@@ -0,0 +1,28 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file
+class MappedFile{
+	public:
+		MappedFile();
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::string& path);
+		void close();
+
+		const char* data() const;
+		size_t size() const;
+		// asks the kernel to start reading [offset, offset + length) of the file into memory
+		void will_need(size_t offset, size_t length) const;
+
+	private:
+		const char* map_start;
+		size_t map_size;
+};
+
+#endif
@@ -0,0 +1,213 @@
+#include "motif_scan.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MOTIF_SCAN_X86
+#include <immintrin.h>
+#endif
+
+MotifScanner::MotifScanner() : patterns(), longest(0), kernel(MotifKernel::scalar){
+    if (kernel_supported(MotifKernel::avx2)){
+        kernel = MotifKernel::avx2;
+    }else if (kernel_supported(MotifKernel::sse2)){
+        kernel = MotifKernel::sse2;
+    }
+}
+
+bool MotifScanner::add_motif(const std::string& motif){
+    if (motif.empty()){
+        return false;
+    }
+    std::string forward {motif};
+    std::transform(forward.begin(), forward.end(), forward.begin(), [](char c){ return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+    std::string reverse {reverse_complement(forward)};
+
+    patterns.push_back({forward, forward.front(), forward.back()});
+    if (reverse != forward){
+        patterns.push_back({reverse, reverse.front(), reverse.back()});
+    }
+    longest = std::max(longest, forward.size());
+    return true;
+}
+
+bool MotifScanner::load(const std::string& path){
+    std::ifstream motif_file(path);
+    if (!motif_file.is_open()){
+        std::cout << "[MotifScanner::load][ERROR] could not open motif file: " << path << '\n';
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(motif_file, line)){
+        if (line.empty() || line[0] == '#'){
+            continue;
+        }
+        // the sequence is the last column, so an optional name column can come first
+        size_t tab {line.find_last_of('\t')};
+        std::string motif {tab == std::string::npos ? line : line.substr(tab + 1)};
+        if (!motif.empty() && motif.back() == '\r'){
+            motif.pop_back();
+        }
+        if (!add_motif(motif)){
+            std::cout << "[MotifScanner::load][ERROR] empty motif in file: " << path << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t MotifScanner::num_patterns() const{
+    return patterns.size();
+}
+
+size_t MotifScanner::max_length() const{
+    return longest;
+}
+
+std::string MotifScanner::pattern_list() const{
+    std::string list;
+    for (auto it = patterns.begin(); it != patterns.end(); it++){
+        if (!list.empty()){
+            list.push_back(',');
+        }
+        list += it->seq;
+    }
+    return list;
+}
+
+uint64_t MotifScanner::count_hits(const char* seq, size_t length, uint64_t limit) const{
+    if (patterns.empty()){
+        return 0;
+    }
+    switch (kernel){
+        case MotifKernel::avx2:
+            return count_avx2(seq, length, limit);
+        case MotifKernel::sse2:
+            return count_sse2(seq, length, limit);
+        default:
+            return count_scalar(seq, length, 0, 0, limit);
+    }
+}
+
+MotifKernel MotifScanner::get_kernel() const{
+    return kernel;
+}
+
+bool MotifScanner::set_kernel(MotifKernel new_kernel){
+    if (!kernel_supported(new_kernel)){
+        return false;
+    }
+    kernel = new_kernel;
+    return true;
+}
+
+bool MotifScanner::kernel_supported(MotifKernel kernel){
+    switch (kernel){
+        case MotifKernel::scalar:
+            return true;
+#ifdef MOTIF_SCAN_X86
+        case MotifKernel::sse2:
+            return __builtin_cpu_supports("sse2");
+        case MotifKernel::avx2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+// Checks every motif at every position from start onwards; also finishes the positions the vector kernels leave over
+uint64_t MotifScanner::count_scalar(const char* seq, size_t length, size_t start, uint64_t count, uint64_t limit) const{
+    for (size_t i{start}; i < length; i++){
+        for (auto it = patterns.begin(); it != patterns.end(); it++){
+            size_t motif_length {it->seq.size()};
+            if (seq[i] == it->first && i + motif_length <= length && seq[i + motif_length - 1] == it->last && std::memcmp(seq + i, it->seq.data(), motif_length) == 0){
+                if (++count > limit){
+                    return count;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+#ifdef MOTIF_SCAN_X86
+// 16 positions per step: one load of the sequence is shared by every motif's first-base test
+__attribute__((target("sse2")))
+uint64_t MotifScanner::count_sse2(const char* seq, size_t length, uint64_t limit) const{
+    const size_t width {16};
+    uint64_t count {0};
+    size_t i {0};
+    for (; i + width + longest - 1 <= length; i += width){
+        __m128i block {_mm_loadu_si128(reinterpret_cast<const __m128i*>(seq + i))};
+        for (auto it = patterns.begin(); it != patterns.end(); it++){
+            size_t motif_length {it->seq.size()};
+            __m128i last_block {_mm_loadu_si128(reinterpret_cast<const __m128i*>(seq + i + motif_length - 1))};
+            __m128i first_match {_mm_cmpeq_epi8(block, _mm_set1_epi8(it->first))};
+            __m128i last_match {_mm_cmpeq_epi8(last_block, _mm_set1_epi8(it->last))};
+            unsigned mask {static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(first_match, last_match)))};
+            while (mask != 0){
+                size_t offset {static_cast<size_t>(__builtin_ctz(mask))};
+                if (std::memcmp(seq + i + offset, it->seq.data(), motif_length) == 0 && ++count > limit){
+                    return count;
+                }
+                mask &= mask - 1;
+            }
+        }
+    }
+    return count_scalar(seq, length, i, count, limit);
+}
+
+// 32 positions per step, same approach as the SSE2 kernel
+__attribute__((target("avx2")))
+uint64_t MotifScanner::count_avx2(const char* seq, size_t length, uint64_t limit) const{
+    const size_t width {32};
+    uint64_t count {0};
+    size_t i {0};
+    for (; i + width + longest - 1 <= length; i += width){
+        __m256i block {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(seq + i))};
+        for (auto it = patterns.begin(); it != patterns.end(); it++){
+            size_t motif_length {it->seq.size()};
+            __m256i last_block {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(seq + i + motif_length - 1))};
+            __m256i first_match {_mm256_cmpeq_epi8(block, _mm256_set1_epi8(it->first))};
+            __m256i last_match {_mm256_cmpeq_epi8(last_block, _mm256_set1_epi8(it->last))};
+            unsigned mask {static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(first_match, last_match)))};
+            while (mask != 0){
+                size_t offset {static_cast<size_t>(__builtin_ctz(mask))};
+                if (std::memcmp(seq + i + offset, it->seq.data(), motif_length) == 0 && ++count > limit){
+                    return count;
+                }
+                mask &= mask - 1;
+            }
+        }
+    }
+    return count_scalar(seq, length, i, count, limit);
+}
+#else
+uint64_t MotifScanner::count_sse2(const char* seq, size_t length, uint64_t limit) const{
+    return count_scalar(seq, length, 0, 0, limit);
+}
+
+uint64_t MotifScanner::count_avx2(const char* seq, size_t length, uint64_t limit) const{
+    return count_scalar(seq, length, 0, 0, limit);
+}
+#endif
+
+std::string reverse_complement(const std::string& seq){
+    std::string result(seq.rbegin(), seq.rend());
+    for (auto it = result.begin(); it != result.end(); it++){
+        switch (*it){
+            case 'A': *it = 'T'; break;
+            case 'C': *it = 'G'; break;
+            case 'G': *it = 'C'; break;
+            case 'T': *it = 'A'; break;
+            default: break;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,53 @@
+#ifndef MOTIF_SCAN_H
+#define MOTIF_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class MotifKernel {scalar, sse2, avx2};
+
+// Counts occurrences of a set of sequence motifs, on both strands, in one pass over a sequence
+// candidate positions are found by comparing the first and last base of every motif against a whole
+// vector of sequence positions at once, and confirmed with a full comparison
+class MotifScanner{
+	public:
+		MotifScanner();
+
+		// adds a motif and its reverse complement (once, if the motif is its own reverse complement)
+		bool add_motif(const std::string& motif);
+		// reads motifs from a file with one motif per line, either as "name<TAB>sequence" or just the sequence
+		bool load(const std::string& path);
+		size_t num_patterns() const;
+		size_t max_length() const;
+		// the motifs as they are matched, separated by commas, to tell whether two scanners find the same hits
+		std::string pattern_list() const;
+
+		// number of motif occurrences in [seq, seq + length); counting stops early once it exceeds limit
+		uint64_t count_hits(const char* seq, size_t length, uint64_t limit = UINT64_MAX) const;
+
+		// the fastest kernel supported by this CPU is chosen on construction
+		MotifKernel get_kernel() const;
+		bool set_kernel(MotifKernel kernel);
+		static bool kernel_supported(MotifKernel kernel);
+
+	private:
+		struct Pattern{
+			std::string seq;
+			char first;
+			char last;
+		};
+
+		uint64_t count_scalar(const char* seq, size_t length, size_t start, uint64_t count, uint64_t limit) const;
+		uint64_t count_sse2(const char* seq, size_t length, uint64_t limit) const;
+		uint64_t count_avx2(const char* seq, size_t length, uint64_t limit) const;
+
+		std::vector<Pattern> patterns;
+		size_t longest;
+		MotifKernel kernel;
+};
+
+std::string reverse_complement(const std::string& seq);
+
+#endif
@@ -0,0 +1,199 @@
+#include "paf_store.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace{
+    const size_t mandatory_columns {12};
+
+    // start of the next field after the one starting at p, or nullptr if it is the last field of the line
+    const char* next_field(const char* p, const char* line_end){
+        const char* tab {static_cast<const char*>(std::memchr(p, '\t', static_cast<size_t>(line_end - p)))};
+        return tab == nullptr ? nullptr : tab + 1;
+    }
+
+    const char* field_end(const char* p, const char* line_end){
+        const char* tab {static_cast<const char*>(std::memchr(p, '\t', static_cast<size_t>(line_end - p)))};
+        return tab == nullptr ? line_end : tab;
+    }
+}
+
+PafStore::PafStore() : file(), lines(), query_names(), query_ids(), query_offsets(), query_records(){}
+
+/* Maps the file and indexes its records by query; empty lines are skipped, and a line with fewer than the 12
+   mandatory PAF columns is an error */
+bool PafStore::open(const std::string& path){
+    close();
+    if (!file.open(path)){
+        std::cout << "[PafStore::open][ERROR] could not open alignment file: " << path << '\n';
+        return false;
+    }
+
+    std::vector<uint32_t> record_queries;
+    const char* p {file.data()};
+    const char* end {p + file.size()};
+    while (p < end){
+        const char* line_end {static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)))};
+        if (line_end == nullptr){
+            line_end = end;
+        }
+        if (line_end > p){
+            size_t num_fields {1 + static_cast<size_t>(std::count(p, line_end, '\t'))};
+            if (num_fields < mandatory_columns){
+                std::cout << "[PafStore::open][ERROR] alignment " << lines.size() + 1 << " of " << path << " has " << num_fields << " fields, expected at least " << mandatory_columns << '\n';
+                close();
+                return false;
+            }
+            TextSpan name {p, static_cast<size_t>(field_end(p, line_end) - p)};
+            auto inserted = query_ids.insert({name.str(), static_cast<uint32_t>(query_names.size())});
+            if (inserted.second){
+                query_names.push_back(name);
+            }
+            record_queries.push_back(inserted.first->second);
+            lines.push_back({p, line_end});
+        }
+        p = line_end + 1;
+    }
+
+    // counting sort of the records by query keeps each query's records in file order
+    query_offsets.assign(query_names.size() + 1, 0);
+    for (auto it = record_queries.begin(); it != record_queries.end(); it++){
+        query_offsets[*it + 1]++;
+    }
+    for (size_t i{1}; i < query_offsets.size(); i++){
+        query_offsets[i] += query_offsets[i - 1];
+    }
+    query_records.resize(lines.size());
+    std::vector<uint32_t> next(query_offsets.begin(), query_offsets.end() - 1);
+    for (size_t i{0}; i < record_queries.size(); i++){
+        query_records[next[record_queries[i]]++] = static_cast<uint32_t>(i);
+    }
+    return true;
+}
+
+void PafStore::close(){
+    file.close();
+    lines.clear();
+    query_names.clear();
+    query_ids.clear();
+    query_offsets.clear();
+    query_records.clear();
+}
+
+size_t PafStore::num_records() const{
+    return lines.size();
+}
+
+size_t PafStore::num_queries() const{
+    return query_names.size();
+}
+
+uint64_t PafStore::file_size() const{
+    return file.size();
+}
+
+TextSpan PafStore::record(size_t i) const{
+    return TextSpan{lines[i].begin, static_cast<size_t>(lines[i].end - lines[i].begin)};
+}
+
+TextSpan PafStore::field(size_t i, size_t column) const{
+    const char* p {lines[i].begin};
+    for (size_t c{0}; c < column && p != nullptr; c++){
+        p = next_field(p, lines[i].end);
+    }
+    if (p == nullptr){
+        return TextSpan{lines[i].end, 0};
+    }
+    return TextSpan{p, static_cast<size_t>(field_end(p, lines[i].end) - p)};
+}
+
+bool PafStore::find_tag(size_t i, const char* name, TextSpan& value) const{
+    const char* line_end {lines[i].end};
+    const char* p {lines[i].begin};
+    for (size_t c{0}; c < mandatory_columns && p != nullptr; c++){
+        p = next_field(p, line_end);
+    }
+    // tags are NAME:TYPE:VALUE
+    for (; p != nullptr; p = next_field(p, line_end)){
+        const char* end {field_end(p, line_end)};
+        if (end - p >= 5 && p[0] == name[0] && p[1] == name[1] && p[2] == ':' && p[4] == ':'){
+            value = TextSpan{p + 5, static_cast<size_t>(end - p - 5)};
+            return true;
+        }
+    }
+    return false;
+}
+
+int64_t PafStore::mapq(size_t i) const{
+    return paf_store::parse_int(field(i, 11));
+}
+
+TextSpan PafStore::query_name(size_t query) const{
+    return query_names[query];
+}
+
+const uint32_t* PafStore::query_records_begin(size_t query) const{
+    return query_records.data() + query_offsets[query];
+}
+
+const uint32_t* PafStore::query_records_end(size_t query) const{
+    return query_records.data() + query_offsets[query + 1];
+}
+
+bool PafStore::find_query(const std::string& name, size_t& query) const{
+    auto found = query_ids.find(name);
+    if (found == query_ids.end()){
+        return false;
+    }
+    query = found->second;
+    return true;
+}
+
+void PafStore::write_records(const std::vector<uint32_t>& records, std::ostream& out) const{
+    for (size_t i{0}; i < records.size();){
+        const char* run_begin {lines[records[i]].begin};
+        const char* run_end {lines[records[i]].end};
+        for (i++; i < records.size() && lines[records[i]].begin == run_end + 1; i++){
+            run_end = lines[records[i]].end;
+        }
+        out.write(run_begin, run_end - run_begin);
+        out.put('\n');
+    }
+}
+
+int64_t paf_store::parse_int(const TextSpan& text){
+    const char* p {text.data};
+    const char* end {p + text.size};
+    bool negative {p < end && *p == '-'};
+    if (negative){
+        p++;
+    }
+    int64_t value {0};
+    for (; p < end && *p >= '0' && *p <= '9'; p++){
+        value = value * 10 + (*p - '0');
+    }
+    return negative ? -value : value;
+}
+
+bool paf_store::filter_mapq(const std::string& in_path, const std::string& out_path, int64_t min_mapq){
+    PafStore alignments;
+    if (!alignments.open(in_path)){
+        return false;
+    }
+    std::vector<uint32_t> kept;
+    for (size_t i{0}; i < alignments.num_records(); i++){
+        if (alignments.mapq(i) >= min_mapq){
+            kept.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    std::ofstream out(out_path);
+    alignments.write_records(kept, out);
+    out.close();
+    if (!out){
+        std::cout << "[paf_store::filter_mapq][ERROR] could not write alignment file: " << out_path << '\n';
+        return false;
+    }
+    return true;
+}
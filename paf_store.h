@@ -0,0 +1,65 @@
+#ifndef PAF_STORE_H
+#define PAF_STORE_H
+
+#include "gfa_scanner.h"
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Alignments of a PAF file mapped into memory; every record is the byte range of its line, and the records of each query
+// (the name in the first column) are indexed together in file order, so readers look records up without copying them
+class PafStore{
+	public:
+		PafStore();
+		bool open(const std::string& path);
+		void close();
+
+		size_t num_records() const;
+		size_t num_queries() const;
+		uint64_t file_size() const;
+
+		// the line of a record, without its newline
+		TextSpan record(size_t i) const;
+		// the column-th tab-separated field of a record (0-based), or an empty span if the record has fewer fields
+		TextSpan field(size_t i, size_t column) const;
+		// value of the tag with the given two-letter name (e.g., P for tp:A:P), searched for by name after the 12 mandatory columns
+		bool find_tag(size_t i, const char* name, TextSpan& value) const;
+		int64_t mapq(size_t i) const;
+
+		TextSpan query_name(size_t query) const;
+		// indices of the records of a query, in file order
+		const uint32_t* query_records_begin(size_t query) const;
+		const uint32_t* query_records_end(size_t query) const;
+		// false if no record has the query name
+		bool find_query(const std::string& name, size_t& query) const;
+
+		// writes the lines of the records (indices in increasing order) to out, copying each run of adjacent lines at once
+		void write_records(const std::vector<uint32_t>& records, std::ostream& out) const;
+
+	private:
+		struct Line{
+			const char* begin;
+			const char* end;
+		};
+
+		MappedFile file;
+		std::vector<Line> lines;
+		std::vector<TextSpan> query_names;
+		std::unordered_map<std::string, uint32_t> query_ids;
+		// the records of query q are query_records[query_offsets[q] .. query_offsets[q + 1])
+		std::vector<uint32_t> query_offsets;
+		std::vector<uint32_t> query_records;
+};
+
+namespace paf_store{
+	// leading decimal integer of the text, 0 if it does not start with one
+	int64_t parse_int(const TextSpan& text);
+	// copies the records of a PAF file with MAPQ >= min_mapq to out_path, in file order
+	bool filter_mapq(const std::string& in_path, const std::string& out_path, int64_t min_mapq);
+}
+
+#endif
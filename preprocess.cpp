@@ -1,19 +1,81 @@
 #include "argument_parser.h"
+#include "gfa_reader.h"
+#include "gfa_scanner.h"
+#include "link_graph.h"
+#include "motif_scan.h"
+#include "paf_store.h"
 #include "preprocess.h"
+#include "support_table.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <assert.h>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
-#include <limits>
+#include <memory>
 #include <stdlib.h>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 
+namespace{
+    // minimap2 reads the tumor-only unitigs and the reference index; its output is counted once it is written
+    void add_alignment_metrics(const std::string& fa_path, const std::string& index_path, const std::string& paf_path, const std::string& filtered_paf_path, uint64_t num_unitigs, StageMetrics& metrics){
+        metrics.bytes_read = run_metrics::file_size(fa_path) + run_metrics::file_size(index_path);
+        metrics.add_count("unitigs", num_unitigs);
+        metrics.add_count("alignments", run_metrics::count_lines(paf_path));
+        metrics.add_count("mapq_filtered_alignments", run_metrics::count_lines(filtered_paf_path));
+    }
+
+    // checks that index_path exists and was written after reference_path was last modified
+    bool index_is_current(const std::string& reference_path, const std::string& index_path){
+        struct stat reference_stat;
+        struct stat index_stat;
+        if (stat(index_path.c_str(), &index_stat) != 0 || index_stat.st_size == 0){
+            return false;
+        }
+        if (stat(reference_path.c_str(), &reference_stat) != 0){
+            return false;
+        }
+        return index_stat.st_mtime >= reference_stat.st_mtime;
+    }
+
+    // parses the comma-separated tumor sample IDs into a lookup table
+    void parse_tumor_ids(const std::string& s, SampleTable& tumor_ids){
+        std::string::const_iterator start = s.begin();
+        std::string::const_iterator end = s.end();
+        std::string::const_iterator next = std::find(start, end, ',');
+        while (next != end) {
+            tumor_ids.add(std::string(start, next));
+            start = next + 1;
+            next = std::find(start, end, ',');
+        }
+        tumor_ids.add(std::string(start, next));
+    }
+
+    // ignore repeat sequences such as telomeres; by default any telomere hit removes a unitig
+    bool load_motifs(ArgumentParser& user_args, MotifScanner& motifs){
+        if (user_args.args.count("--motif-file")){
+            return motifs.load(user_args.args["--motif-file"]);
+        }
+        motifs.add_motif("TTAGGGTTAGGGTTAGGGTTAGGGTTAGGG");
+        return true;
+    }
+
+    // a unitig is kept if its motif hits per kb do not exceed the maximum density
+    uint64_t max_motif_hits(double max_motif_density, uint64_t sequence_length){
+        return static_cast<uint64_t>(max_motif_density * static_cast<double>(sequence_length) / 1000);
+    }
+}
+
 bool preprocess::file_setup(ArgumentParser& user_args){
     // create output directory if it doesn't already exist
     std::string cmd {"mkdir -p " + user_args.args["-o"] + "/intermediate_output/"};
@@ -43,7 +105,36 @@ bool preprocess::check_args(ArgumentParser& user_args){
         user_args.args.insert({"--min-mapq", "10"});
     }
 
-    if (!user_args.check_file("--graph", ".gfa")){
+    if (user_args.args.count("--max-motif-density") == 0){
+        user_args.args.insert({"--max-motif-density", "0"});
+    }
+
+    if (user_args.args.count("--support-table") == 0){
+        user_args.args.insert({"--support-table", user_args.args["-o"] + "/intermediate_output/unitig_support.bin"});
+    }
+
+    if (user_args.args.count("--from-support-table") == 0){
+        user_args.args.insert({"--from-support-table", "no"});
+    }
+    if (user_args.args["--from-support-table"] != "yes" && user_args.args["--from-support-table"] != "no"){
+        std::cout << "[preprocess::check_args][ERROR] --from-support-table must be yes or no\n";
+        return false;
+    }
+    // run also loads the links of the graph, so it has to scan the graph anyway
+    if (user_args.args["--from-support-table"] == "yes" && user_args.args["command"] != "preprocess"){
+        std::cout << "[preprocess::check_args][ERROR] --from-support-table is only supported by preprocess\n";
+        return false;
+    }
+
+    if (user_args.args.count("--pipeline") == 0){
+        user_args.args.insert({"--pipeline", "yes"});
+    }
+    if (user_args.args["--pipeline"] != "yes" && user_args.args["--pipeline"] != "no"){
+        std::cout << "[preprocess::check_args][ERROR] --pipeline must be yes or no\n";
+        return false;
+    }
+
+    if (!user_args.check_file("--graph", ".gfa", true)){
         std::cout << "[preprocess::check_args][ERROR] could not open graph file: " << user_args.args["--graph"] << '\n';
         return false;
     }
@@ -53,88 +144,222 @@ bool preprocess::check_args(ArgumentParser& user_args){
         return false;
     }
 
+    struct stat buffer;
+    if (user_args.args.count("--motif-file") && stat(user_args.args["--motif-file"].c_str(), &buffer) != 0){
+        std::cout << "[preprocess::check_args][ERROR] could not open motif file: " << user_args.args["--motif-file"] << '\n';
+        return false;
+    }
+
     return true;
 }
 
 /* Identifies tumor-only unitigs from given .gfa file */
-bool preprocess::filter_unitigs(ArgumentParser& user_args){
-    std::ifstream gfa_file(user_args.args["--graph"]);
+bool preprocess::filter_unitigs(ArgumentParser& user_args, StageMetrics& metrics){
+    return filter_unitigs(user_args, nullptr, nullptr, nullptr, metrics);
+}
+
+/* Identifies tumor-only unitigs from given .gfa file; if graph is given, the links of the graph are loaded into it in the
+   same pass, and every tumor-only unitig is marked in all_tumor_utgs (indexed by node ID); if pipeline is given, the
+   unitigs to align are passed to it as soon as they are written */
+bool preprocess::filter_unitigs(ArgumentParser& user_args, LinkGraph* graph, std::vector<bool>* all_tumor_utgs, AlignmentPipeline* pipeline, StageMetrics& metrics){
+    unsigned num_threads {static_cast<unsigned>(std::stoi(user_args.args["-t"]))};
+    // the support table and the graph cache are matched to the graph by its size, modification time and inode, taken before
+    // the scan so that a graph changed during the scan does not match; the graph is not hashed, which would read it again
+    FileFingerprint gfa_fingerprint {};
+    GfaReader gfa_file;
+    if (!file_fingerprint(user_args.args["--graph"], gfa_fingerprint) || !gfa_file.open(user_args.args["--graph"], num_threads)){
+        std::cout << "[preprocess::filter_unitigs][ERROR] could not open graph file: " << user_args.args["--graph"] << '\n';
+        return false;
+    }
     std::ofstream out_tumor_utg_all(user_args.args["-o"] + "/intermediate_output/all_tumor_only_unitigs.txt");
     std::ofstream out_tumor_utg_thresh(user_args.args["-o"] + "/intermediate_output/thresh_tumor_only_unitigs.txt");
     std::ofstream out_tumor_fa(user_args.args["-o"] + "/intermediate_output/tumor_only_unitigs.fa");
 
-    // parse tumor sample IDs into list
-    std::vector<std::string> tumor_ids;
-    std::string s = user_args.args["--tumor-ids"];
-    std::string::const_iterator start = s.begin();
-    std::string::const_iterator end = s.end();
-    std::string::const_iterator next = std::find(start, end, ',');
-    while (next != end) {
-        tumor_ids.push_back(std::string(start, next));
-        start = next + 1;
-        next = std::find(start, end, ',');
-    }
-    tumor_ids.push_back(std::string(start, next));
+    SampleTable tumor_ids;
+    parse_tumor_ids(user_args.args["--tumor-ids"], tumor_ids);
 
-    int read_thresh {std::stoi(user_args.args["--min-reads"])};
+    uint32_t read_thresh {static_cast<uint32_t>(std::stoi(user_args.args["--min-reads"]))};
     char read_delim {user_args.args["--read-sep"][0]};
 
-    // ignore telomere sequences
-    std::string tel_seq_for {"TTAGGGTTAGGGTTAGGGTTAGGGTTAGGG"};
-    std::string tel_seq_rev {"CCCTAACCCTAACCCTAACCCTAACCCTAA"};
+    MotifScanner motifs;
+    if (!load_motifs(user_args, motifs)){
+        return false;
+    }
+    double max_motif_density {std::stod(user_args.args["--max-motif-density"])};
 
-    // variables for parsing .gfa file
-    std::string line_type, unitig, ignore, segment, read_id;
-    int num_tumor_reads{0};
-    int num_healthy_reads{0};
+    // S names and L line ends are kept in file order (an S line has no second end), so node IDs match a separate load of the graph
+    struct ChunkOutput{
+        ChunkOutput() : all_utgs(), thresh_utgs(), fasta(), graph_lines(), tumor_utgs(), samples(), support(new SupportTable()), num_segments(0), num_tumor_utgs(0), num_thresh_utgs(0){}
+        std::string all_utgs;
+        std::string thresh_utgs;
+        std::string fasta;
+        std::vector<std::pair<TextSpan, TextSpan>> graph_lines;
+        std::vector<TextSpan> tumor_utgs;
+        // the support of every segment, with its reads counted per sample and the offset of its sequence, goes to the
+        // support table; sample numbers are local to the range until the range is written
+        SampleIndex samples;
+        std::unique_ptr<SupportTable> support;
+        uint64_t num_segments;
+        uint64_t num_tumor_utgs;
+        uint64_t num_thresh_utgs;
+    };
 
-    // double check we're starting with a segment line
-    gfa_file >> line_type;
-    if (line_type.c_str()[0] != 'S'){
-        std::cout << "[preprocess::filter_unitigs][ERROR] .gfa file must begin with S line\n";
-        return false;
+    // with a link memory budget, links that do not fit are sorted into runs next to the graph cache and merged into it
+    LinkGraphBuilder builder;
+    uint64_t link_memory {graph != nullptr ? std::stoull(user_args.args["--link-memory"]) << 20 : 0};
+    std::string cache_path {user_args.args["-o"] + "/intermediate_output/link_graph.bin"};
+    if (link_memory > 0){
+        builder.spill_links(cache_path, link_memory);
     }
-    gfa_file >> unitig >> segment;
+    SupportTable support;
+    SampleIndex all_samples;
+    std::vector<uint32_t> tumor_utg_ids;
+    uint64_t num_segments {0};
+    uint64_t num_tumor_utgs {0};
+    uint64_t num_thresh_utgs {0};
 
-    gfa_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    // the graph is read in windows of whole segments (a plain file is one window, compressed files are decompressed
+    // a batch at a time); each window is split into ranges of whole segments that are classified in parallel
+    // each range collects its output in memory, and ranges are written to the output files in their original order
+    auto start_time = std::chrono::steady_clock::now();
+    const size_t max_chunk_size {size_t{256} << 20};
+    const char* window_begin;
+    const char* window_end;
+    bool first_window {true};
+    while (gfa_file.next(window_begin, window_end)){
+        // double check we're starting with a segment line
+        if (first_window && *window_begin != 'S'){
+            break;
+        }
+        first_window = false;
 
+        size_t window_size {static_cast<size_t>(window_end - window_begin)};
+        size_t num_chunks {std::max(size_t{num_threads} * 8, window_size / max_chunk_size + 1)};
+        std::vector<const char*> bounds {gfa_scanner::split_at_segments(window_begin, window_end, num_chunks)};
+        std::vector<ChunkOutput> chunk_outputs(bounds.size() - 1);
+        uint64_t window_offset {gfa_file.window_offset()};
 
-    while(gfa_file >> line_type){
-        if (line_type.c_str()[0] == 'S'){
-            // end of the node, so reset for the next node
-            // first, write unitig info if this is a tumor-only node
-            if(num_tumor_reads >= 0 && num_healthy_reads == 0){
-                out_tumor_utg_all << unitig << '\n';
-                // only keep candidates above read threshold that do not contain telomere sequence
-                if (num_tumor_reads >= read_thresh && !(segment.find(tel_seq_for) != std::string::npos || segment.find(tel_seq_rev) != std::string::npos)){
-                    out_tumor_utg_thresh << unitig << '\n';
-                    out_tumor_fa << '>' << unitig << '\n' << segment << '\n';
+        run_in_order(chunk_outputs.size(), num_threads, [&](unsigned, size_t i){
+            ChunkOutput& out {chunk_outputs[i]};
+            std::function<void(const TextSpan&)> on_segment_name;
+            std::function<void(const TextSpan&, const TextSpan&)> on_link;
+            if (graph != nullptr){
+                on_segment_name = [&](const TextSpan& name){
+                    out.graph_lines.push_back({name, TextSpan{nullptr, 0}});
+                };
+                on_link = [&](const TextSpan& source, const TextSpan& target){
+                    out.graph_lines.push_back({source, target});
+                };
+            }
+            // segment names and sequences point into the window, and are only copied when written out
+            gfa_scanner::scan_graph(bounds[i], bounds[i + 1], tumor_ids, read_delim, [&](const SegmentSupport& segment){
+                out.num_segments++;
+                // only tumor-only unitigs above the read threshold have their motifs counted, and in full, so a later run
+                // with another --max-motif-density does not need their sequences; the others are left uncounted, and a
+                // later --min-reads that keeps them reads their sequences from the graph
+                bool count_motifs {segment.normal_reads == 0 && segment.tumor_reads >= read_thresh};
+                uint64_t hits {count_motifs ? motifs.count_hits(segment.sequence.data, segment.sequence.size) : 0};
+                uint32_t motif_hits {count_motifs ? static_cast<uint32_t>(std::min(hits, uint64_t{SupportTable::motifs_not_counted - 1})) : SupportTable::motifs_not_counted};
+                out.support->add_segment(segment.name, window_offset + static_cast<uint64_t>(segment.sequence.data - window_begin), segment.sequence.size, motif_hits, *segment.sample_reads);
+                if (segment.normal_reads > 0){
+                    return;
+                }
+                out.num_tumor_utgs++;
+                out.all_utgs.append(segment.name.data, segment.name.size).push_back('\n');
+                if (graph != nullptr){
+                    out.tumor_utgs.push_back(segment.name);
                 }
+                if (segment.tumor_reads < read_thresh){
+                    return;
+                }
+                // only keep candidates above read threshold whose motif hits per kb do not exceed the maximum density
+                if (hits <= max_motif_hits(max_motif_density, segment.sequence.size)){
+                    out.num_thresh_utgs++;
+                    out.thresh_utgs.append(segment.name.data, segment.name.size).push_back('\n');
+                    out.fasta.push_back('>');
+                    out.fasta.append(segment.name.data, segment.name.size).push_back('\n');
+                    out.fasta.append(segment.sequence.data, segment.sequence.size).push_back('\n');
+                }
+            }, on_segment_name, on_link, &out.samples);
+        }, [&](size_t i){
+            ChunkOutput done;
+            std::swap(done, chunk_outputs[i]);
+            out_tumor_utg_all << done.all_utgs;
+            out_tumor_utg_thresh << done.thresh_utgs;
+            out_tumor_fa << done.fasta;
+            if (pipeline != nullptr){
+                pipeline->add(std::move(done.fasta));
             }
-
-            gfa_file >> unitig >> segment;
-
-            num_tumor_reads = 0;
-            num_healthy_reads = 0;
-        }else if (line_type.c_str()[0] == 'A'){
-            gfa_file >> ignore >> ignore >> ignore >> read_id;
-            // check if this read comes from a non-tumor sample
-            if (std::find(std::begin(tumor_ids), std::end(tumor_ids), read_id.substr(0, read_id.find(read_delim))) != std::end(tumor_ids)){
-                num_tumor_reads++;
-            }else{
-                num_healthy_reads++;
+            num_segments += done.num_segments;
+            num_tumor_utgs += done.num_tumor_utgs;
+            num_thresh_utgs += done.num_thresh_utgs;
+            // node IDs are assigned here, in file order, while the workers scan the following ranges
+            for (auto it = done.graph_lines.begin(); it != done.graph_lines.end(); it++){
+                if (it->second.data == nullptr){
+                    builder.add_segment(it->first.data, it->first.size);
+                }else{
+                    builder.add_link(it->first.data, it->first.size, it->second.data, it->second.size);
+                }
             }
-        }
-        gfa_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            // the S line of a tumor-only unitig was added above, so this only looks up its ID
+            for (auto it = done.tumor_utgs.begin(); it != done.tumor_utgs.end(); it++){
+                tumor_utg_ids.push_back(builder.add_segment(it->data, it->size));
+            }
+            // sample numbers of the range are replaced by those of the whole graph
+            std::vector<uint32_t> sample_ids(done.samples.size());
+            for (uint32_t id{0}; id < sample_ids.size(); id++){
+                const std::string& name {done.samples.name(id)};
+                sample_ids[id] = all_samples.id(name.data(), name.size());
+                if (sample_ids[id] == support.num_samples()){
+                    support.add_sample(name);
+                }
+            }
+            support.append(*done.support, sample_ids);
+            return true;
+        });
+    }
+    if (gfa_file.failed()){
+        return false;
+    }
+    if (first_window){
+        std::cout << "[preprocess::filter_unitigs][ERROR] .gfa file must begin with S line\n";
+        return false;
     }
 
-    if(num_tumor_reads >= 0 && num_healthy_reads == 0){
-        out_tumor_utg_all << unitig << '\n';
-        if (num_tumor_reads >= read_thresh){
-            out_tumor_utg_thresh << unitig << '\n';
-            out_tumor_fa << '>' << unitig << '\n' << segment << '\n';
+    // later preprocess runs with other thresholds can read the table instead of scanning the graph again
+    if (!support.write(user_args.args["--support-table"], gfa_fingerprint, read_delim, motifs.pattern_list())){
+        std::cout << "[preprocess::filter_unitigs][WARNING] could not write support table: " << user_args.args["--support-table"] << '\n';
+    }
+    if (graph != nullptr){
+        if (link_memory == 0){
+            graph->build(builder, gfa_fingerprint);
+        }else if (!graph->build_cache(builder, gfa_fingerprint, cache_path)){
+            return false;
+        }
+        all_tumor_utgs->assign(graph->num_nodes(), false);
+        for (auto it = tumor_utg_ids.begin(); it != tumor_utg_ids.end(); it++){
+            (*all_tumor_utgs)[*it] = true;
         }
     }
+    std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - start_time};
+
+    metrics.bytes_read = gfa_file.file_size();
+    if (gfa_file.is_compressed()){
+        metrics.add_count("decompressed_bytes", gfa_file.text_size());
+    }
+    metrics.add_count("segments", num_segments);
+    metrics.add_count("tumor_only_unitigs", num_tumor_utgs);
+    metrics.add_count("candidate_unitigs", num_thresh_utgs);
+    if (graph != nullptr){
+        metrics.add_count("links", graph->num_links());
+    }
+
+    double text_mb {static_cast<double>(gfa_file.text_size()) / (1 << 20)};
+    std::cout << "[preprocess::filter_unitigs] scanned " << text_mb << " MB of graph";
+    if (gfa_file.is_compressed()){
+        std::cout << " (" << static_cast<double>(gfa_file.file_size()) / (1 << 20) << " MB compressed)";
+    }
+    std::cout << " in " << elapsed.count() << " s with " << num_threads << " threads (" << text_mb / std::max(elapsed.count(), 1e-9) << " MB/s)\n";
 
     // close input and output files
     gfa_file.close();
@@ -145,22 +370,228 @@ bool preprocess::filter_unitigs(ArgumentParser& user_args){
     return true;
 }
 
-bool preprocess::align_unitigs(ArgumentParser& user_args){
-    std::string cmd;
-    struct stat buffer;   
-    // check for minimap executable in colorSV directory first, then $PATH
+/* Identifies tumor-only unitigs from the support table written by an earlier scan of the same graph, without scanning the
+   graph again: the reads of each unitig are summed over the samples in --tumor-ids, motif hits stored in the table are used
+   if the motifs are the same as those of the scan, and only the sequences of the unitigs above the read threshold that still
+   need a motif count or go into the FASTA file are read from the graph, at their recorded offsets */
+bool preprocess::filter_unitigs_from_table(ArgumentParser& user_args, AlignmentPipeline* pipeline, StageMetrics& metrics){
+    auto start_time = std::chrono::steady_clock::now();
+    std::string table_path {user_args.args["--support-table"]};
+    SupportTable support;
+    if (!support.open(table_path)){
+        return false;
+    }
+    FileFingerprint gfa_fingerprint {};
+    if (!file_fingerprint(user_args.args["--graph"], gfa_fingerprint)){
+        std::cout << "[preprocess::filter_unitigs_from_table][ERROR] could not open graph file: " << user_args.args["--graph"] << '\n';
+        return false;
+    }
+    // the table only holds offsets into the graph it was built from, and sample IDs split with its read separator; like the
+    // graph cache, it is matched to the graph by size, modification time and inode, so the graph is not read to check it
+    if (!same_contents(user_args.args["--graph"], gfa_fingerprint, support.gfa_fingerprint())){
+        std::cout << "[preprocess::filter_unitigs_from_table][ERROR] support table " << table_path << " was built from a different graph file, run preprocess with --from-support-table no to rebuild it\n";
+        return false;
+    }
+    char read_delim {user_args.args["--read-sep"][0]};
+    if (support.read_sep() != read_delim){
+        std::cout << "[preprocess::filter_unitigs_from_table][ERROR] support table " << table_path << " was built with read separator " << support.read_sep() << ", run preprocess with --from-support-table no to rebuild it\n";
+        return false;
+    }
+
+    SampleTable tumor_ids;
+    parse_tumor_ids(user_args.args["--tumor-ids"], tumor_ids);
+    std::vector<bool> tumor_samples(support.num_samples());
+    for (uint32_t i{0}; i < support.num_samples(); i++){
+        std::string name {support.sample_name(i)};
+        tumor_samples[i] = tumor_ids.contains(name.data(), name.size());
+    }
+
+    uint32_t read_thresh {static_cast<uint32_t>(std::stoi(user_args.args["--min-reads"]))};
+    MotifScanner motifs;
+    if (!load_motifs(user_args, motifs)){
+        return false;
+    }
+    double max_motif_density {std::stod(user_args.args["--max-motif-density"])};
+    bool motifs_counted {support.motif_list() == motifs.pattern_list()};
+
+    std::ofstream out_tumor_utg_all(user_args.args["-o"] + "/intermediate_output/all_tumor_only_unitigs.txt");
+    std::ofstream out_tumor_utg_thresh(user_args.args["-o"] + "/intermediate_output/thresh_tumor_only_unitigs.txt");
+    std::ofstream out_tumor_fa(user_args.args["-o"] + "/intermediate_output/tumor_only_unitigs.fa");
+
+    // unitigs above the read threshold that were not rejected by their stored motif hits, in file order
+    std::vector<uint32_t> candidates;
+    uint64_t num_tumor_utgs {0};
+    for (uint32_t id{0}; id < support.num_segments(); id++){
+        uint64_t tumor_reads {0};
+        uint64_t normal_reads {0};
+        for (uint64_t r {support.reads_begin(id)}; r < support.reads_end(id); r++){
+            (tumor_samples[support.read_sample(r)] ? tumor_reads : normal_reads) += support.read_count(r);
+        }
+        if (normal_reads > 0){
+            continue;
+        }
+        num_tumor_utgs++;
+        TextSpan name {support.name(id)};
+        out_tumor_utg_all.write(name.data, static_cast<std::streamsize>(name.size)).put('\n');
+        if (tumor_reads < read_thresh){
+            continue;
+        }
+        uint32_t hits {support.motif_hits(id)};
+        if (motifs_counted && hits != SupportTable::motifs_not_counted && hits > max_motif_hits(max_motif_density, support.sequence_length(id))){
+            continue;
+        }
+        candidates.push_back(id);
+    }
+
+    // the graph is read in windows as during the scan; a plain file is mapped as one window, so only the pages holding the
+    // sequences of candidates are read, and a compressed file is decompressed up to the last candidate
+    const size_t fasta_batch_size {size_t{16} << 20};
+    unsigned num_threads {static_cast<unsigned>(std::stoi(user_args.args["-t"]))};
+    GfaReader gfa_file;
+    if (!gfa_file.open(user_args.args["--graph"], num_threads)){
+        std::cout << "[preprocess::filter_unitigs_from_table][ERROR] could not open graph file: " << user_args.args["--graph"] << '\n';
+        return false;
+    }
+    uint64_t num_thresh_utgs {0};
+    uint64_t sequence_bytes {0};
+    size_t next_candidate {0};
+    std::string fasta;
+    const char* window_begin;
+    const char* window_end;
+    while (next_candidate < candidates.size() && gfa_file.next(window_begin, window_end)){
+        uint64_t window_offset {gfa_file.window_offset()};
+        uint64_t window_size {static_cast<uint64_t>(window_end - window_begin)};
+        for (; next_candidate < candidates.size() && support.sequence_offset(candidates[next_candidate]) < window_offset + window_size; next_candidate++){
+            uint32_t id {candidates[next_candidate]};
+            uint64_t offset {support.sequence_offset(id)};
+            uint64_t length {support.sequence_length(id)};
+            if (offset < window_offset || offset + length > window_offset + window_size){
+                std::cout << "[preprocess::filter_unitigs_from_table][ERROR] support table " << table_path << " does not match the graph file, run preprocess with --from-support-table no to rebuild it\n";
+                return false;
+            }
+            const char* sequence {window_begin + (offset - window_offset)};
+            sequence_bytes += length;
+            if (!motifs_counted || support.motif_hits(id) == SupportTable::motifs_not_counted){
+                uint64_t max_hits {max_motif_hits(max_motif_density, length)};
+                if (motifs.count_hits(sequence, length, max_hits) > max_hits){
+                    continue;
+                }
+            }
+            num_thresh_utgs++;
+            TextSpan name {support.name(id)};
+            out_tumor_utg_thresh.write(name.data, static_cast<std::streamsize>(name.size)).put('\n');
+            fasta.push_back('>');
+            fasta.append(name.data, name.size).push_back('\n');
+            fasta.append(sequence, length).push_back('\n');
+            if (fasta.size() >= fasta_batch_size){
+                out_tumor_fa << fasta;
+                if (pipeline != nullptr){
+                    pipeline->add(std::move(fasta));
+                }
+                fasta.clear();
+            }
+        }
+    }
+    if (gfa_file.failed()){
+        return false;
+    }
+    if (next_candidate < candidates.size()){
+        std::cout << "[preprocess::filter_unitigs_from_table][ERROR] graph file ends before the sequence of unitig " << support.name(candidates[next_candidate]).str() << ", run preprocess with --from-support-table no to rebuild the support table\n";
+        return false;
+    }
+    out_tumor_fa << fasta;
+    if (pipeline != nullptr){
+        pipeline->add(std::move(fasta));
+    }
+    std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - start_time};
+
+    metrics.bytes_read = run_metrics::file_size(table_path) + sequence_bytes;
+    if (gfa_file.is_compressed()){
+        metrics.add_count("decompressed_bytes", gfa_file.text_size());
+    }
+    metrics.add_count("segments", support.num_segments());
+    metrics.add_count("tumor_only_unitigs", num_tumor_utgs);
+    metrics.add_count("candidate_unitigs", num_thresh_utgs);
+    metrics.add_count("sequence_bytes", sequence_bytes);
+
+    std::cout << "[preprocess::filter_unitigs_from_table] read " << support.num_segments() << " unitigs from the support table and " << static_cast<double>(sequence_bytes) / (1 << 20) << " MB of sequence in " << elapsed.count() << " s\n";
+
+    gfa_file.close();
+    out_tumor_utg_all.close();
+    out_tumor_utg_thresh.close();
+    out_tumor_fa.close();
+    return true;
+}
+
+/* Picks where the minimap2 index of the reference is kept: --reference-index if given, otherwise next to
+   the reference so that every sample aligned against it shares the index, or in the output directory
+   when the reference directory is not writable */
+std::string preprocess::reference_index_path(ArgumentParser& user_args){
+    if (user_args.args.count("--reference-index")){
+        return user_args.args["--reference-index"];
+    }
+
+    std::string shared_path {user_args.args["--reference"] + ".lr_hq.mmi"};
+    size_t dir_end {shared_path.find_last_of('/')};
+    std::string reference_dir {dir_end == std::string::npos ? "." : shared_path.substr(0, dir_end + 1)};
+    struct stat buffer;
+    if (stat(shared_path.c_str(), &buffer) == 0 || access(reference_dir.c_str(), W_OK) == 0){
+        return shared_path;
+    }
+    return user_args.args["-o"] + "/intermediate_output/" + shared_path.substr(dir_end == std::string::npos ? 0 : dir_end + 1);
+}
+
+/* Checks for the minimap2 executable in the colorSV directory first, then $PATH */
+std::string preprocess::minimap2_executable(ArgumentParser& user_args){
+    struct stat buffer;
     if (stat((user_args.args["exe_path"] + "minimap2").c_str(), &buffer) == 0){
-        cmd  = user_args.args["exe_path"] + "minimap2";
-    }else{
-        cmd = "minimap2";
+        return user_args.args["exe_path"] + "minimap2";
+    }
+    return "minimap2";
+}
+
+/* Builds the minimap2 index of the reference at index_path with the minimap2 executable, unless it is already current; the
+   index is written to a file named after the process and renamed into place, so a killed run never leaves a partial index
+   behind and runs that index the same reference at once do not write into each other's file */
+bool preprocess::index_reference(ArgumentParser& user_args, const std::string& index_path){
+    if (index_is_current(user_args.args["--reference"], index_path)){
+        return true;
     }
+    std::cout << "[preprocess::index_reference] indexing reference, saving index to " << index_path << '\n';
+    std::string tmp_path {index_path + ".tmp." + std::to_string(getpid())};
+    std::string cmd {minimap2_executable(user_args) + " -x lr:hq -t" + user_args.args["-t"] + " -d " + tmp_path + " " + user_args.args["--reference"]};
+    if (system(cmd.c_str()) != 0 || std::rename(tmp_path.c_str(), index_path.c_str()) != 0){
+        std::cout << "[preprocess::index_reference][ERROR] could not index reference: " << user_args.args["--reference"] << '\n';
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+/* Aligns tumor-only unitigs to the reference and keeps alignments with at least --min-mapq */
+bool preprocess::align_unitigs(ArgumentParser& user_args, StageMetrics& metrics){
+    std::string index_path {reference_index_path(user_args)};
+    std::string fa_path {user_args.args["-o"] + "/intermediate_output/tumor_only_unitigs.fa"};
+    std::string paf_path {user_args.args["-o"] + "/intermediate_output/tumor_only_unitigs.paf"};
+    std::string filtered_paf_path {user_args.args["-o"] + "/intermediate_output/tumor_only_unitigs_mapq_filtered.paf"};
+
+    // index the reference once and reuse the index in later runs
+    if (!index_reference(user_args, index_path)){
+        return false;
+    }
+
     // tumor-only unitig alignment to reference
-    cmd += " -cx lr:hq -t" + user_args.args["-t"] + " --ds " + user_args.args["--reference"] + " " + user_args.args["-o"] + "/intermediate_output/tumor_only_unitigs.fa > " + user_args.args["-o"] + "/intermediate_output/tumor_only_unitigs.paf";
-    system(cmd.c_str());
+    std::string cmd {minimap2_executable(user_args) + " -cx lr:hq -t" + user_args.args["-t"] + " --ds " + index_path + " " + fa_path + " > " + paf_path};
+    if (system(cmd.c_str()) != 0){
+        std::cout << "[preprocess::align_unitigs][ERROR] minimap2 could not align tumor-only unitigs: " << fa_path << '\n';
+        return false;
+    }
 
     // filter to only keep alignments with minimum MAPQ score
-    cmd = "awk '$12 >= " + user_args.args["--min-mapq"] + "' " + user_args.args["-o"] + "/intermediate_output/tumor_only_unitigs.paf > " + user_args.args["-o"] + "/intermediate_output/tumor_only_unitigs_mapq_filtered.paf";
-    system(cmd.c_str());
+    if (!paf_store::filter_mapq(paf_path, filtered_paf_path, std::stoll(user_args.args["--min-mapq"]))){
+        return false;
+    }
 
+    add_alignment_metrics(fa_path, index_path, paf_path, filtered_paf_path, run_metrics::count_lines(fa_path) / 2, metrics);
     return true;
 }
@@ -1,13 +1,24 @@
 #ifndef PREPROCESS_H
 #define PREPROCESS_H
 
+#include "alignment_pipeline.h"
 #include "argument_parser.h"
+#include "link_graph.h"
+#include "run_metrics.h"
+
+#include <string>
+#include <vector>
 
 namespace preprocess{
 	bool file_setup(ArgumentParser& user_args);
-	bool align_unitigs(ArgumentParser& user_args);
-	bool filter_unitigs(ArgumentParser& user_args);
+	bool align_unitigs(ArgumentParser& user_args, StageMetrics& metrics);
+	bool index_reference(ArgumentParser& user_args, const std::string& index_path);
+	std::string minimap2_executable(ArgumentParser& user_args);
+	bool filter_unitigs(ArgumentParser& user_args, StageMetrics& metrics);
+	bool filter_unitigs(ArgumentParser& user_args, LinkGraph* graph, std::vector<bool>* all_tumor_utgs, AlignmentPipeline* pipeline, StageMetrics& metrics);
+	bool filter_unitigs_from_table(ArgumentParser& user_args, AlignmentPipeline* pipeline, StageMetrics& metrics);
 	bool check_args(ArgumentParser& user_args);
+	std::string reference_index_path(ArgumentParser& user_args);
 }
 
 #endif
@@ -0,0 +1,136 @@
+#include "region_mask.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <utility>
+
+namespace{
+    const int64_t no_region_distance {1000000000};
+
+    bool name_less(const std::string& name, const TextSpan& contig){
+        int cmp {std::memcmp(name.data(), contig.data, std::min(name.size(), contig.size))};
+        return cmp < 0 || (cmp == 0 && name.size() < contig.size);
+    }
+
+    int64_t parse_coordinate(const TextSpan& field){
+        return std::strtoll(field.str().c_str(), nullptr, 10);
+    }
+}
+
+RegionMask::RegionMask() : contigs(), region_count(0){}
+
+bool RegionMask::load(const std::string& bed_path){
+    std::ifstream bed_file(bed_path);
+    if (!bed_file){
+        return false;
+    }
+
+    std::map<std::string, std::vector<std::pair<int64_t, int64_t>>> regions;
+    std::string line;
+    TextSpan fields[3];
+    region_count = 0;
+    while (std::getline(bed_file, line)){
+        if (gfa_scanner::split_fields(line.data(), line.data() + line.size(), fields, 3) < 3){
+            continue;
+        }
+        int64_t start {parse_coordinate(fields[1])};
+        int64_t end {parse_coordinate(fields[2])};
+        if (end < start){
+            continue;
+        }
+        regions[fields[0].str()].emplace_back(start, end);
+        region_count++;
+    }
+
+    contigs.clear();
+    for (auto it = regions.begin(); it != regions.end(); it++){
+        std::vector<std::pair<int64_t, int64_t>>& intervals {it->second};
+        std::sort(intervals.begin(), intervals.end());
+
+        contigs.emplace_back();
+        ContigRegions& contig {contigs.back()};
+        contig.name = it->first;
+        int64_t max_end {intervals.front().second};
+        for (auto interval = intervals.begin(); interval != intervals.end(); interval++){
+            max_end = std::max(max_end, interval->second);
+            contig.starts.push_back(interval->first);
+            contig.max_ends.push_back(max_end);
+
+            // touching or overlapping regions are merged, empty ones add nothing
+            if (interval->second == interval->first){
+                continue;
+            }
+            if (!contig.merged_ends.empty() && interval->first <= contig.merged_ends.back()){
+                contig.merged_ends.back() = std::max(contig.merged_ends.back(), interval->second);
+            }else{
+                int64_t covered {contig.merged_ends.empty() ? 0 : contig.covered_before.back() + contig.merged_ends.back() - contig.merged_starts.back()};
+                contig.merged_starts.push_back(interval->first);
+                contig.merged_ends.push_back(interval->second);
+                contig.covered_before.push_back(covered);
+            }
+        }
+        int64_t covered {contig.merged_ends.empty() ? 0 : contig.covered_before.back() + contig.merged_ends.back() - contig.merged_starts.back()};
+        contig.covered_before.push_back(covered);
+    }
+    return true;
+}
+
+size_t RegionMask::num_regions() const{
+    return region_count;
+}
+
+int64_t RegionMask::find_contig(const TextSpan& contig) const{
+    auto it = std::lower_bound(contigs.begin(), contigs.end(), contig, [](const ContigRegions& entry, const TextSpan& name){
+        return name_less(entry.name, name);
+    });
+    if (it == contigs.end() || it->name.size() != contig.size || std::memcmp(it->name.data(), contig.data, contig.size) != 0){
+        return -1;
+    }
+    return it - contigs.begin();
+}
+
+int64_t RegionMask::distance(const TextSpan& contig, int64_t pos) const{
+    int64_t index {find_contig(contig)};
+    if (index < 0){
+        return no_region_distance;
+    }
+    const ContigRegions& regions {contigs[static_cast<size_t>(index)]};
+
+    // the closest region either starts after pos or is the one reaching furthest among those starting at or before pos
+    int64_t min {no_region_distance};
+    size_t next {static_cast<size_t>(std::upper_bound(regions.starts.begin(), regions.starts.end(), pos) - regions.starts.begin())};
+    if (next < regions.starts.size()){
+        min = std::min(min, regions.starts[next] - pos);
+    }
+    if (next > 0){
+        int64_t max_end {regions.max_ends[next - 1]};
+        min = std::min(min, pos < max_end ? 0 : pos - max_end);
+    }
+    return min;
+}
+
+int64_t RegionMask::overlap(const TextSpan& contig, int64_t start, int64_t end) const{
+    int64_t index {find_contig(contig)};
+    if (index < 0 || end <= start){
+        return 0;
+    }
+    const ContigRegions& regions {contigs[static_cast<size_t>(index)]};
+
+    // merged intervals [first, last) intersect [start, end); clip the outer two
+    size_t first {static_cast<size_t>(std::upper_bound(regions.merged_ends.begin(), regions.merged_ends.end(), start) - regions.merged_ends.begin())};
+    size_t last {static_cast<size_t>(std::lower_bound(regions.merged_starts.begin(), regions.merged_starts.end(), end) - regions.merged_starts.begin())};
+    if (first >= last){
+        return 0;
+    }
+    int64_t covered {regions.covered_before[last] - regions.covered_before[first]};
+    covered -= std::max<int64_t>(0, start - regions.merged_starts[first]);
+    covered -= std::max<int64_t>(0, regions.merged_ends[last - 1] - end);
+    return covered;
+}
+
+bool RegionMask::covers(const TextSpan& contig, int64_t start, int64_t end) const{
+    return end > start && overlap(contig, start, end) == end - start;
+}
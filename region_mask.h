@@ -0,0 +1,44 @@
+#ifndef REGION_MASK_H
+#define REGION_MASK_H
+
+#include "gfa_scanner.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Regions of the --filter BED file (e.g., centromeres), indexed per contig for O(log n) distance and overlap queries
+class RegionMask{
+	public:
+		RegionMask();
+		bool load(const std::string& bed_path);
+		size_t num_regions() const;
+
+		// index of the contig in the mask, or -1 if it has no regions
+		int64_t find_contig(const TextSpan& contig) const;
+		// distance from pos to the closest region of the contig (0 inside a region), 1e9 if the contig has no regions
+		int64_t distance(const TextSpan& contig, int64_t pos) const;
+		// number of bases in [start, end) covered by regions of the contig
+		int64_t overlap(const TextSpan& contig, int64_t start, int64_t end) const;
+		// true if every base in [start, end) is covered by regions of the contig
+		bool covers(const TextSpan& contig, int64_t start, int64_t end) const;
+
+	private:
+		struct ContigRegions{
+			ContigRegions() : name(), starts(), max_ends(), merged_starts(), merged_ends(), covered_before(){}
+
+			std::string name;
+			// regions sorted by start, with the largest end of each prefix of them
+			std::vector<int64_t> starts;
+			std::vector<int64_t> max_ends;
+			// union of the regions as disjoint sorted intervals, with the bases covered before each interval
+			std::vector<int64_t> merged_starts;
+			std::vector<int64_t> merged_ends;
+			std::vector<int64_t> covered_before;
+		};
+
+		std::vector<ContigRegions> contigs;
+		size_t region_count;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "mapped_file.h"
+#include "run_metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+namespace{
+    // every run is written in this format, so that the next run can be appended before the closing brackets
+    const char runs_begin[] {"{\"runs\": [\n"};
+    const char runs_end[] {"\n]}\n"};
+
+    double seconds(const struct timeval& time){
+        return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) / 1e6;
+    }
+}
+
+Histogram::Histogram() : buckets(), num_values(0), sum(0), max_value(0){}
+
+void Histogram::add(uint64_t value){
+    size_t bucket {0};
+    while (bucket < 64 && (value >> bucket) != 0){
+        bucket++;
+    }
+    if (buckets.size() <= bucket){
+        buckets.resize(bucket + 1, 0);
+    }
+    buckets[bucket]++;
+    num_values++;
+    sum += value;
+    max_value = std::max(max_value, value);
+}
+
+// buckets are listed by their largest value
+void Histogram::write_json(std::ostream& out) const{
+    out << "{\"count\": " << num_values << ", \"sum\": " << sum << ", \"max\": " << max_value << ", \"bucket_max\": [";
+    for (size_t i{0}; i < buckets.size(); i++){
+        out << (i > 0 ? ", " : "") << (i == 0 ? 0 : (i == 64 ? UINT64_MAX : (uint64_t{1} << i) - 1));
+    }
+    out << "], \"bucket_count\": [";
+    for (size_t i{0}; i < buckets.size(); i++){
+        out << (i > 0 ? ", " : "") << buckets[i];
+    }
+    out << "]}";
+}
+
+StageMetrics::StageMetrics() : name(), wall_seconds(0.0), cpu_seconds(0.0), peak_rss_kb(0), bytes_read(0), counts(), histograms(){}
+
+void StageMetrics::add_count(const std::string& name, uint64_t value){
+    for (auto it = counts.begin(); it != counts.end(); it++){
+        if (it->first == name){
+            it->second += value;
+            return;
+        }
+    }
+    counts.emplace_back(name, value);
+}
+
+Histogram& StageMetrics::histogram(const std::string& name){
+    for (auto it = histograms.begin(); it != histograms.end(); it++){
+        if (it->first == name){
+            return it->second;
+        }
+    }
+    histograms.emplace_back(name, Histogram());
+    return histograms.back().second;
+}
+
+RunMetrics::RunMetrics(const std::string& command) : command(command), stages(), in_stage(false), run_start(std::chrono::steady_clock::now()), stage_start(run_start), run_cpu_start(cpu_seconds()), stage_cpu_start(run_cpu_start){}
+
+StageMetrics& RunMetrics::begin_stage(const std::string& name){
+    end_stage();
+    stages.emplace_back();
+    stages.back().name = name;
+    in_stage = true;
+    stage_start = std::chrono::steady_clock::now();
+    stage_cpu_start = cpu_seconds();
+    return stages.back();
+}
+
+void RunMetrics::end_stage(){
+    if (!in_stage){
+        return;
+    }
+    std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - stage_start};
+    StageMetrics& stage {stages.back()};
+    stage.wall_seconds = elapsed.count();
+    stage.cpu_seconds = cpu_seconds() - stage_cpu_start;
+    stage.peak_rss_kb = peak_rss_kb();
+    in_stage = false;
+}
+
+/* Appends this run to the runs of earlier commands in the file, or starts a new file if there is none (or it was not written by
+   colorSV); the file is replaced in one rename, so an interrupted run never leaves a partial file behind */
+bool RunMetrics::write(const std::string& path){
+    end_stage();
+    std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - run_start};
+
+    std::ostringstream run;
+    run << "{\"command\": \"" << command << "\", \"start_time\": " << static_cast<int64_t>(std::time(nullptr) - static_cast<std::time_t>(elapsed.count()))
+        << ", \"wall_seconds\": " << elapsed.count() << ", \"cpu_seconds\": " << cpu_seconds() - run_cpu_start << ", \"peak_rss_kb\": " << peak_rss_kb() << ",\n \"stages\": [";
+    for (auto it = stages.begin(); it != stages.end(); it++){
+        run << (it == stages.begin() ? "\n" : ",\n") << "  {\"name\": \"" << it->name << "\", \"wall_seconds\": " << it->wall_seconds << ", \"cpu_seconds\": " << it->cpu_seconds
+            << ", \"peak_rss_kb\": " << it->peak_rss_kb << ", \"bytes_read\": " << it->bytes_read << ",\n   \"counts\": {";
+        for (auto count = it->counts.begin(); count != it->counts.end(); count++){
+            run << (count == it->counts.begin() ? "" : ", ") << '"' << count->first << "\": " << count->second;
+        }
+        run << "},\n   \"histograms\": {";
+        for (auto histogram = it->histograms.begin(); histogram != it->histograms.end(); histogram++){
+            run << (histogram == it->histograms.begin() ? "\n    " : ",\n    ") << '"' << histogram->first << "\": ";
+            histogram->second.write_json(run);
+        }
+        run << "}}";
+    }
+    run << "\n ]}";
+
+    std::string content {runs_begin};
+    MappedFile old_file;
+    const size_t end_size {sizeof(runs_end) - 1};
+    if (old_file.open(path) && old_file.size() > sizeof(runs_begin) - 1 + end_size && std::memcmp(old_file.data(), runs_begin, sizeof(runs_begin) - 1) == 0 &&
+        std::memcmp(old_file.data() + old_file.size() - end_size, runs_end, end_size) == 0){
+        content.assign(old_file.data(), old_file.size() - end_size);
+        content += ",\n";
+    }
+    old_file.close();
+    content += run.str();
+    content += runs_end;
+
+    std::string tmp_path {path + ".tmp"};
+    std::ofstream out(tmp_path, std::ios::trunc);
+    out << content;
+    out.close();
+    if (!out || std::rename(tmp_path.c_str(), path.c_str()) != 0){
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+double RunMetrics::cpu_seconds(){
+    struct rusage self, children;
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+    return seconds(self.ru_utime) + seconds(self.ru_stime) + seconds(children.ru_utime) + seconds(children.ru_stime);
+}
+
+// ru_maxrss is in KB on Linux
+uint64_t RunMetrics::peak_rss_kb(){
+    struct rusage self, children;
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+    return static_cast<uint64_t>(std::max(self.ru_maxrss, children.ru_maxrss));
+}
+
+uint64_t run_metrics::file_size(const std::string& path){
+    struct stat buffer;
+    if (stat(path.c_str(), &buffer) != 0){
+        return 0;
+    }
+    return static_cast<uint64_t>(buffer.st_size);
+}
+
+uint64_t run_metrics::count_lines(const std::string& path){
+    MappedFile file;
+    if (!file.open(path) || file.size() == 0){
+        return 0;
+    }
+    uint64_t lines {static_cast<uint64_t>(std::count(file.data(), file.data() + file.size(), '\n'))};
+    // a last line without a newline still counts
+    return lines + (file.data()[file.size() - 1] != '\n');
+}
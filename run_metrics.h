@@ -0,0 +1,73 @@
+#ifndef RUN_METRICS_H
+#define RUN_METRICS_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Counts of values in power-of-two buckets: bucket 0 holds the value 0 and bucket i the values in [2^(i-1), 2^i)
+class Histogram{
+	public:
+		Histogram();
+		void add(uint64_t value);
+		void write_json(std::ostream& out) const;
+
+	private:
+		std::vector<uint64_t> buckets;
+		uint64_t num_values;
+		uint64_t sum;
+		uint64_t max_value;
+};
+
+// Resources used by one stage of a command, and the records it processed; stages fill in bytes_read, counts and histograms
+struct StageMetrics{
+	StageMetrics();
+	void add_count(const std::string& name, uint64_t value);
+	Histogram& histogram(const std::string& name);
+
+	std::string name;
+	double wall_seconds;
+	// CPU time of colorSV and of the programs it ran (e.g., minimap2) during the stage
+	double cpu_seconds;
+	// peak RSS of colorSV, or of the largest program it ran, up to the end of the stage
+	uint64_t peak_rss_kb;
+	uint64_t bytes_read;
+	std::vector<std::pair<std::string, uint64_t>> counts;
+	std::vector<std::pair<std::string, Histogram>> histograms;
+};
+
+// Times the stages of one command one after another, and appends them as one run to the metrics.json file of the output directory
+class RunMetrics{
+	public:
+		explicit RunMetrics(const std::string& command);
+		// ends the current stage, if any, and starts timing the next one
+		StageMetrics& begin_stage(const std::string& name);
+		void end_stage();
+		bool write(const std::string& path);
+
+	private:
+		static double cpu_seconds();
+		static uint64_t peak_rss_kb();
+
+		std::string command;
+		// a deque, so that the stage returned by begin_stage stays valid while later stages are added
+		std::deque<StageMetrics> stages;
+		bool in_stage;
+		std::chrono::steady_clock::time_point run_start;
+		std::chrono::steady_clock::time_point stage_start;
+		double run_cpu_start;
+		double stage_cpu_start;
+};
+
+namespace run_metrics{
+	// size of a file in bytes, 0 if it cannot be read
+	uint64_t file_size(const std::string& path);
+	// number of lines of a file, 0 if it cannot be read
+	uint64_t count_lines(const std::string& path);
+}
+
+#endif
@@ -0,0 +1,279 @@
+#include "support_table.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace{
+    // table layout: header, then sample name offsets, sample names, the motif list, segment name offsets, segment names,
+    // sequence offsets, sequence lengths, motif hits, read offsets, read samples and read counts
+    // every column starts on an 8-byte boundary so it can be used in place after mapping
+    const char table_magic[8] {'C', 'S', 'V', 'S', 'U', 'P', 'R', 'T'};
+    const uint32_t table_version {3};
+
+    struct TableHeader{
+        char magic[8];
+        uint32_t version;
+        uint32_t read_sep;
+        uint32_t sample_count;
+        uint32_t segment_count;
+        uint64_t read_count;
+        uint64_t sample_names_size;
+        uint64_t names_size;
+        uint64_t motif_list_size;
+        FileFingerprint gfa;
+    };
+
+    struct TableLayout{
+        uint64_t sample_name_offsets;
+        uint64_t sample_names;
+        uint64_t motif_list;
+        uint64_t name_offsets;
+        uint64_t names;
+        uint64_t sequence_offsets;
+        uint64_t sequence_lengths;
+        uint64_t motif_hits;
+        uint64_t read_offsets;
+        uint64_t read_samples;
+        uint64_t read_counts;
+        uint64_t total;
+    };
+
+    uint64_t pad8(uint64_t bytes){
+        return (bytes + 7) / 8 * 8;
+    }
+
+    TableLayout table_layout(const TableHeader& header){
+        uint64_t segments {header.segment_count};
+        TableLayout layout;
+        layout.sample_name_offsets = sizeof(TableHeader);
+        layout.sample_names = layout.sample_name_offsets + pad8((header.sample_count + uint64_t{1}) * sizeof(uint64_t));
+        layout.motif_list = layout.sample_names + pad8(header.sample_names_size);
+        layout.name_offsets = layout.motif_list + pad8(header.motif_list_size);
+        layout.names = layout.name_offsets + pad8((segments + 1) * sizeof(uint64_t));
+        layout.sequence_offsets = layout.names + pad8(header.names_size);
+        layout.sequence_lengths = layout.sequence_offsets + pad8(segments * sizeof(uint64_t));
+        layout.motif_hits = layout.sequence_lengths + pad8(segments * sizeof(uint64_t));
+        layout.read_offsets = layout.motif_hits + pad8(segments * sizeof(uint32_t));
+        layout.read_samples = layout.read_offsets + pad8((segments + 1) * sizeof(uint64_t));
+        layout.read_counts = layout.read_samples + pad8(header.read_count * sizeof(uint32_t));
+        layout.total = layout.read_counts + pad8(header.read_count * sizeof(uint32_t));
+        return layout;
+    }
+
+    void write_padded(std::ofstream& out, const void* data, uint64_t bytes){
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        const char zeros[8] {};
+        out.write(zeros, static_cast<std::streamsize>(pad8(bytes) - bytes));
+    }
+}
+
+SupportTable::SupportTable() : sample_name_offset_store(1, 0), sample_name_store(), name_offset_store(1, 0), name_store(), sequence_offset_store(), sequence_length_store(), motif_hit_store(),
+    read_offset_store(1, 0), read_sample_store(), read_count_store(), table_file(), source(), separator(0), motifs(), sample_count(0), segment_count(0),
+    sample_name_offsets(nullptr), sample_names(nullptr), name_offsets(nullptr), names(nullptr), sequence_offsets(nullptr), sequence_lengths(nullptr), motif_hit_counts(nullptr),
+    read_offsets(nullptr), read_samples(nullptr), read_counts(nullptr){
+    update_views();
+}
+
+uint32_t SupportTable::add_sample(const std::string& name){
+    sample_name_store += name;
+    sample_name_offset_store.push_back(sample_name_store.size());
+    update_views();
+    return sample_count - 1;
+}
+
+void SupportTable::add_segment(const TextSpan& name, uint64_t sequence_offset, uint64_t sequence_length, uint32_t motif_hits, const std::vector<std::pair<uint32_t, uint32_t>>& sample_reads){
+    name_store.append(name.data, name.size);
+    name_offset_store.push_back(name_store.size());
+    sequence_offset_store.push_back(sequence_offset);
+    sequence_length_store.push_back(sequence_length);
+    motif_hit_store.push_back(motif_hits);
+    for (auto it = sample_reads.begin(); it != sample_reads.end(); it++){
+        read_sample_store.push_back(it->first);
+        read_count_store.push_back(it->second);
+    }
+    read_offset_store.push_back(read_sample_store.size());
+    update_views();
+}
+
+void SupportTable::append(const SupportTable& part, const std::vector<uint32_t>& sample_ids){
+    uint64_t names_base {name_store.size()};
+    name_store += part.name_store;
+    for (auto it = part.name_offset_store.begin() + 1; it != part.name_offset_store.end(); it++){
+        name_offset_store.push_back(names_base + *it);
+    }
+    sequence_offset_store.insert(sequence_offset_store.end(), part.sequence_offset_store.begin(), part.sequence_offset_store.end());
+    sequence_length_store.insert(sequence_length_store.end(), part.sequence_length_store.begin(), part.sequence_length_store.end());
+    motif_hit_store.insert(motif_hit_store.end(), part.motif_hit_store.begin(), part.motif_hit_store.end());
+    uint64_t reads_base {read_sample_store.size()};
+    for (auto it = part.read_offset_store.begin() + 1; it != part.read_offset_store.end(); it++){
+        read_offset_store.push_back(reads_base + *it);
+    }
+    for (auto it = part.read_sample_store.begin(); it != part.read_sample_store.end(); it++){
+        read_sample_store.push_back(sample_ids[*it]);
+    }
+    read_count_store.insert(read_count_store.end(), part.read_count_store.begin(), part.read_count_store.end());
+    update_views();
+}
+
+bool SupportTable::write(const std::string& path, const FileFingerprint& gfa_fingerprint, char read_sep, const std::string& motif_list) const{
+    TableHeader header;
+    std::memcpy(header.magic, table_magic, sizeof(table_magic));
+    header.version = table_version;
+    header.read_sep = static_cast<unsigned char>(read_sep);
+    header.sample_count = sample_count;
+    header.segment_count = segment_count;
+    header.read_count = read_offsets[segment_count];
+    header.sample_names_size = sample_name_offsets[sample_count];
+    header.names_size = name_offsets[segment_count];
+    header.motif_list_size = motif_list.size();
+    header.gfa = gfa_fingerprint;
+
+    // write to a temporary file first so an interrupted run never leaves a truncated table behind
+    std::string tmp_path {path + ".tmp"};
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()){
+        return false;
+    }
+    write_padded(out, &header, sizeof(TableHeader));
+    write_padded(out, sample_name_offsets, (sample_count + uint64_t{1}) * sizeof(uint64_t));
+    write_padded(out, sample_names, header.sample_names_size);
+    write_padded(out, motif_list.data(), header.motif_list_size);
+    write_padded(out, name_offsets, (segment_count + uint64_t{1}) * sizeof(uint64_t));
+    write_padded(out, names, header.names_size);
+    write_padded(out, sequence_offsets, segment_count * sizeof(uint64_t));
+    write_padded(out, sequence_lengths, segment_count * sizeof(uint64_t));
+    write_padded(out, motif_hit_counts, segment_count * sizeof(uint32_t));
+    write_padded(out, read_offsets, (segment_count + uint64_t{1}) * sizeof(uint64_t));
+    write_padded(out, read_samples, header.read_count * sizeof(uint32_t));
+    write_padded(out, read_counts, header.read_count * sizeof(uint32_t));
+    out.close();
+    if (out.fail()){
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool SupportTable::open(const std::string& path){
+    if (!table_file.open(path)){
+        std::cout << "[SupportTable::open][ERROR] could not open support table: " << path << '\n';
+        return false;
+    }
+
+    bool valid {false};
+    TableHeader header;
+    if (table_file.size() < sizeof(TableHeader)){
+        std::cout << "[SupportTable::open][ERROR] support table is truncated: " << path << '\n';
+    }else{
+        std::memcpy(&header, table_file.data(), sizeof(TableHeader));
+        if (std::memcmp(header.magic, table_magic, sizeof(table_magic)) != 0 || header.version != table_version){
+            std::cout << "[SupportTable::open][ERROR] support table has an unsupported format version: " << path << '\n';
+        }else if (table_file.size() != table_layout(header).total){
+            std::cout << "[SupportTable::open][ERROR] support table is truncated: " << path << '\n';
+        }else{
+            valid = true;
+        }
+    }
+
+    if (!valid){
+        table_file.close();
+    }
+    update_views();
+    return valid;
+}
+
+// Points the column views at the table mapping if one is open, otherwise at the columns built in memory
+void SupportTable::update_views(){
+    if (table_file.data() != nullptr){
+        TableHeader header;
+        std::memcpy(&header, table_file.data(), sizeof(TableHeader));
+        TableLayout layout {table_layout(header)};
+        const char* base {table_file.data()};
+        source = header.gfa;
+        separator = static_cast<char>(header.read_sep);
+        motifs.assign(base + layout.motif_list, header.motif_list_size);
+        sample_count = header.sample_count;
+        segment_count = header.segment_count;
+        sample_name_offsets = reinterpret_cast<const uint64_t*>(base + layout.sample_name_offsets);
+        sample_names = base + layout.sample_names;
+        name_offsets = reinterpret_cast<const uint64_t*>(base + layout.name_offsets);
+        names = base + layout.names;
+        sequence_offsets = reinterpret_cast<const uint64_t*>(base + layout.sequence_offsets);
+        sequence_lengths = reinterpret_cast<const uint64_t*>(base + layout.sequence_lengths);
+        motif_hit_counts = reinterpret_cast<const uint32_t*>(base + layout.motif_hits);
+        read_offsets = reinterpret_cast<const uint64_t*>(base + layout.read_offsets);
+        read_samples = reinterpret_cast<const uint32_t*>(base + layout.read_samples);
+        read_counts = reinterpret_cast<const uint32_t*>(base + layout.read_counts);
+        return;
+    }
+    sample_count = static_cast<uint32_t>(sample_name_offset_store.size() - 1);
+    segment_count = static_cast<uint32_t>(name_offset_store.size() - 1);
+    sample_name_offsets = sample_name_offset_store.data();
+    sample_names = sample_name_store.data();
+    name_offsets = name_offset_store.data();
+    names = name_store.data();
+    sequence_offsets = sequence_offset_store.data();
+    sequence_lengths = sequence_length_store.data();
+    motif_hit_counts = motif_hit_store.data();
+    read_offsets = read_offset_store.data();
+    read_samples = read_sample_store.data();
+    read_counts = read_count_store.data();
+}
+
+const FileFingerprint& SupportTable::gfa_fingerprint() const{
+    return source;
+}
+
+char SupportTable::read_sep() const{
+    return separator;
+}
+
+std::string SupportTable::motif_list() const{
+    return motifs;
+}
+
+uint32_t SupportTable::num_samples() const{
+    return sample_count;
+}
+
+std::string SupportTable::sample_name(uint32_t sample) const{
+    return std::string(sample_names + sample_name_offsets[sample], sample_names + sample_name_offsets[sample + 1]);
+}
+
+uint32_t SupportTable::num_segments() const{
+    return segment_count;
+}
+
+TextSpan SupportTable::name(uint32_t id) const{
+    return TextSpan{names + name_offsets[id], static_cast<size_t>(name_offsets[id + 1] - name_offsets[id])};
+}
+
+uint64_t SupportTable::sequence_offset(uint32_t id) const{
+    return sequence_offsets[id];
+}
+
+uint64_t SupportTable::sequence_length(uint32_t id) const{
+    return sequence_lengths[id];
+}
+
+uint32_t SupportTable::motif_hits(uint32_t id) const{
+    return motif_hit_counts[id];
+}
+
+uint64_t SupportTable::reads_begin(uint32_t id) const{
+    return read_offsets[id];
+}
+
+uint64_t SupportTable::reads_end(uint32_t id) const{
+    return read_offsets[id + 1];
+}
+
+uint32_t SupportTable::read_sample(uint64_t i) const{
+    return read_samples[i];
+}
+
+uint32_t SupportTable::read_count(uint64_t i) const{
+    return read_counts[i];
+}
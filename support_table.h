@@ -0,0 +1,89 @@
+#ifndef SUPPORT_TABLE_H
+#define SUPPORT_TABLE_H
+
+#include "gfa_scanner.h"
+#include "link_graph.h"
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Read support of every segment of a graph, saved by the graph scan of preprocess so that tumor-only unitigs can be picked
+// again with other thresholds, tumor IDs or motifs without scanning the graph; every field is a column indexed by node ID,
+// and the columns either live in memory while the table is built or are mapped from the table file
+class SupportTable{
+	public:
+		// motif_hits of a segment whose motifs were not counted
+		static const uint32_t motifs_not_counted {UINT32_MAX};
+
+		SupportTable();
+		SupportTable(const SupportTable&) = delete;
+		SupportTable& operator=(const SupportTable&) = delete;
+
+		// samples and segments are added in file order; sample_reads holds (sample, reads) pairs with sample numbers from add_sample
+		uint32_t add_sample(const std::string& name);
+		void add_segment(const TextSpan& name, uint64_t sequence_offset, uint64_t sequence_length, uint32_t motif_hits, const std::vector<std::pair<uint32_t, uint32_t>>& sample_reads);
+		// appends the segments of a table built in memory for a part of the graph, whose sample numbers map to sample_ids here
+		void append(const SupportTable& part, const std::vector<uint32_t>& sample_ids);
+		// the graph is identified by its fingerprint, and motif_list is MotifScanner::pattern_list of the counted motifs
+		bool write(const std::string& path, const FileFingerprint& gfa_fingerprint, char read_sep, const std::string& motif_list) const;
+		bool open(const std::string& path);
+
+		const FileFingerprint& gfa_fingerprint() const;
+		char read_sep() const;
+		std::string motif_list() const;
+
+		uint32_t num_samples() const;
+		std::string sample_name(uint32_t sample) const;
+		uint32_t num_segments() const;
+		TextSpan name(uint32_t id) const;
+		// offset of the sequence in the decompressed graph text
+		uint64_t sequence_offset(uint32_t id) const;
+		uint64_t sequence_length(uint32_t id) const;
+		uint32_t motif_hits(uint32_t id) const;
+		// the samples supporting segment id, with their read counts, are at [reads_begin(id), reads_end(id))
+		uint64_t reads_begin(uint32_t id) const;
+		uint64_t reads_end(uint32_t id) const;
+		uint32_t read_sample(uint64_t i) const;
+		uint32_t read_count(uint64_t i) const;
+
+	private:
+		void update_views();
+
+		// columns built during the scan
+		std::vector<uint64_t> sample_name_offset_store;
+		std::string sample_name_store;
+		std::vector<uint64_t> name_offset_store;
+		std::string name_store;
+		std::vector<uint64_t> sequence_offset_store;
+		std::vector<uint64_t> sequence_length_store;
+		std::vector<uint32_t> motif_hit_store;
+		std::vector<uint64_t> read_offset_store;
+		std::vector<uint32_t> read_sample_store;
+		std::vector<uint32_t> read_count_store;
+
+		// columns mapped from the table file
+		MappedFile table_file;
+
+		// views of whichever columns are in use
+		FileFingerprint source;
+		char separator;
+		std::string motifs;
+		uint32_t sample_count;
+		uint32_t segment_count;
+		const uint64_t* sample_name_offsets;
+		const char* sample_names;
+		const uint64_t* name_offsets;
+		const char* names;
+		const uint64_t* sequence_offsets;
+		const uint64_t* sequence_lengths;
+		const uint32_t* motif_hit_counts;
+		const uint64_t* read_offsets;
+		const uint32_t* read_samples;
+		const uint32_t* read_counts;
+};
+
+#endif
@@ -0,0 +1,1027 @@
+#include "mapped_file.h"
+#include "sv_extract.h"
+#include "thread_pool.h"
+#include "topology_search.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sys/stat.h>
+
+namespace{
+    // Position on a reference contig at one end of an alignment
+    struct EndCoordinate{
+        TextSpan ctg;
+        char ori;
+        int64_t pos;
+        int64_t ql;
+    };
+
+    // One primary PAF alignment; all text fields point into the mapped PAF file
+    struct Alignment{
+        TextSpan qname;
+        TextSpan path;
+        TextSpan cigar;
+        TextSpan ds;
+        bool has_ds;
+        char strand;
+        int64_t mapq;
+        int64_t qlen;
+        int64_t qst;
+        int64_t qen;
+        int64_t tlen;
+        int64_t tst;
+        int64_t ten;
+        EndCoordinate ends[2];
+    };
+
+    // Reference segment of a path (or the whole contig when the alignment target is a contig)
+    struct PathSegment{
+        TextSpan ctg;
+        int64_t ctg_st;
+        int64_t ctg_en;
+        int strand;
+        int64_t path_st;
+        int64_t path_en;
+    };
+
+    struct ContigOffset{
+        size_t seg;
+        int64_t pos;
+    };
+
+    // Long insertion or deletion found in a CIGAR, refined with the TSD and inserted sequence from ds:Z
+    struct LongIndel{
+        int64_t st;
+        int64_t en;
+        int64_t len;
+        int64_t qoff_l;
+        int64_t qoff_r;
+        int64_t stl;
+        int64_t enl;
+        int64_t str;
+        int64_t enr;
+        bool has_seq;
+        TextSpan indel_seq;
+        TextSpan tsd_left;
+        TextSpan tsd_right;
+        TextSpan int_seq;
+        int64_t polyA_len;
+        // stl, enl, str and enr converted to contig coordinates
+        ContigOffset ctg_offsets[4];
+    };
+
+    // Buffers reused by one worker across query groups
+    struct Workspace{
+        Workspace() : fields(), group(), kept(), indels(), segments(), tsd_seq(), int_seq(), sv_info(){}
+
+        std::vector<TextSpan> fields;
+        std::vector<Alignment> group;
+        std::vector<const Alignment*> kept;
+        std::vector<LongIndel> indels;
+        std::vector<PathSegment> segments;
+        std::string tsd_seq;
+        std::string int_seq;
+        std::string sv_info;
+    };
+
+    bool is_letter(char c){
+        return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+    }
+
+    bool is_digit(char c){
+        return c >= '0' && c <= '9';
+    }
+
+    bool is_space(char c){
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    bool equals(const TextSpan& a, const TextSpan& b){
+        return a.size == b.size && std::memcmp(a.data, b.data, a.size) == 0;
+    }
+
+    bool equals(const TextSpan& a, const char* b){
+        size_t b_size {std::strlen(b)};
+        return a.size == b_size && std::memcmp(a.data, b, b_size) == 0;
+    }
+
+    bool starts_with(const TextSpan& a, const char* prefix){
+        size_t prefix_size {std::strlen(prefix)};
+        return a.size >= prefix_size && std::memcmp(a.data, prefix, prefix_size) == 0;
+    }
+
+    bool less_than(const TextSpan& a, const TextSpan& b){
+        int cmp {std::memcmp(a.data, b.data, std::min(a.size, b.size))};
+        return cmp < 0 || (cmp == 0 && a.size < b.size);
+    }
+
+    bool contains_path_orientation(const TextSpan& s){
+        return std::memchr(s.data, '>', s.size) != nullptr || std::memchr(s.data, '<', s.size) != nullptr;
+    }
+
+    // leading integer of the text, like parseInt
+    int64_t parse_int(const char* p, const char* end){
+        while (p < end && is_space(*p)){
+            p++;
+        }
+        bool negative {false};
+        if (p < end && (*p == '-' || *p == '+')){
+            negative = *p == '-';
+            p++;
+        }
+        int64_t value {0};
+        for (; p < end && is_digit(*p); p++){
+            value = value * 10 + (*p - '0');
+        }
+        return negative ? -value : value;
+    }
+
+    int64_t parse_int(const TextSpan& s){
+        return parse_int(s.data, s.data + s.size);
+    }
+
+    void append(std::string& out, const TextSpan& s){
+        out.append(s.data, s.size);
+    }
+
+    void append_int(std::string& out, int64_t value){
+        char buffer[24];
+        char* p {buffer + sizeof(buffer)};
+        uint64_t magnitude {value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value)};
+        do{
+            *--p = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        }while (magnitude > 0);
+        if (value < 0){
+            *--p = '-';
+        }
+        out.append(p, static_cast<size_t>(buffer + sizeof(buffer) - p));
+    }
+
+    // calls on_op(length, op) for every (\d+)([=XIDMSHN]) in the CIGAR
+    template<typename OpHandler>
+    void for_each_cigar_op(const TextSpan& cigar, OpHandler on_op){
+        const char* p {cigar.data};
+        const char* end {cigar.data + cigar.size};
+        while (p < end){
+            if (!is_digit(*p)){
+                p++;
+                continue;
+            }
+            int64_t length {0};
+            for (; p < end && is_digit(*p); p++){
+                length = length * 10 + (*p - '0');
+            }
+            if (p < end && std::strchr("=XIDMSHN", *p) != nullptr){
+                on_op(length, *p);
+                p++;
+            }
+        }
+    }
+
+    // calls on_op(op, text) for every ([+-*:])([A-Za-z\[\]0-9]+) in the ds:Z tag
+    template<typename OpHandler>
+    bool for_each_ds_op(const TextSpan& ds, OpHandler on_op){
+        const char* p {ds.data};
+        const char* end {ds.data + ds.size};
+        while (p < end){
+            if (std::strchr("+-*:", *p) == nullptr || *p == '\0'){
+                p++;
+                continue;
+            }
+            const char* text_end {p + 1};
+            while (text_end < end && (is_letter(*text_end) || is_digit(*text_end) || *text_end == '[' || *text_end == ']')){
+                text_end++;
+            }
+            if (text_end == p + 1){
+                p++;
+                continue;
+            }
+            if (!on_op(*p, TextSpan{p + 1, static_cast<size_t>(text_end - p - 1)})){
+                return false;
+            }
+            p = text_end;
+        }
+        return true;
+    }
+
+    // calls on_segment(orientation, contig, start, end) for every ([><])([^><:\s]+):(\d+)-(\d+) in the path
+    template<typename SegmentHandler>
+    void for_each_path_segment(const TextSpan& path, SegmentHandler on_segment){
+        const char* p {path.data};
+        const char* end {path.data + path.size};
+        for (; p < end; p++){
+            if (*p != '>' && *p != '<'){
+                continue;
+            }
+            const char* name_end {p + 1};
+            while (name_end < end && *name_end != '>' && *name_end != '<' && *name_end != ':' && !is_space(*name_end)){
+                name_end++;
+            }
+            if (name_end == p + 1 || name_end == end || *name_end != ':'){
+                continue;
+            }
+            const char* start_end {name_end + 1};
+            while (start_end < end && is_digit(*start_end)){
+                start_end++;
+            }
+            if (start_end == name_end + 1 || start_end == end || *start_end != '-'){
+                continue;
+            }
+            const char* end_end {start_end + 1};
+            while (end_end < end && is_digit(*end_end)){
+                end_end++;
+            }
+            if (end_end == start_end + 1){
+                continue;
+            }
+            on_segment(*p, TextSpan{p + 1, static_cast<size_t>(name_end - p - 1)}, parse_int(name_end + 1, start_end), parse_int(start_end + 1, end_end));
+            p = end_end - 1;
+        }
+    }
+
+    // splits an INDEL sequence from ds:Z into an optional [left TSD], the internal sequence and an optional [right TSD]
+    bool split_tsd(const TextSpan& s, TextSpan& tsd_left, TextSpan& int_seq, TextSpan& tsd_right){
+        const char* end {s.data + s.size};
+        for (const char* p {s.data}; p < end; p++){
+            const char* core {p};
+            tsd_left = TextSpan{p, 0};
+            if (*p == '['){
+                const char* letters_end {p + 1};
+                while (letters_end < end && is_letter(*letters_end)){
+                    letters_end++;
+                }
+                if (letters_end > p + 1 && letters_end < end && *letters_end == ']' && letters_end + 1 < end && is_letter(letters_end[1])){
+                    tsd_left = TextSpan{p + 1, static_cast<size_t>(letters_end - p - 1)};
+                    core = letters_end + 1;
+                }
+            }
+            const char* core_end {core};
+            while (core_end < end && is_letter(*core_end)){
+                core_end++;
+            }
+            if (core_end == core){
+                continue;
+            }
+            int_seq = TextSpan{core, static_cast<size_t>(core_end - core)};
+
+            tsd_right = TextSpan{core_end, 0};
+            if (core_end < end && *core_end == '['){
+                const char* letters_end {core_end + 1};
+                while (letters_end < end && is_letter(*letters_end)){
+                    letters_end++;
+                }
+                if (letters_end > core_end + 1 && letters_end < end && *letters_end == ']'){
+                    tsd_right = TextSpan{core_end + 1, static_cast<size_t>(letters_end - core_end - 1)};
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // length of the polyA tail (positive) or polyT head (negative) of an inserted sequence
+    int64_t polyA_length(const ExtractOptions& opt, const TextSpan& int_seq){
+        int64_t length {static_cast<int64_t>(int_seq.size)};
+        int64_t score {0};
+        int64_t max {0};
+        int64_t max_j {length};
+        for (int64_t j {length - 1}; j >= 0; j--){
+            char c {int_seq.data[j]};
+            if (c == 'A' || c == 'a'){
+                score++;
+            }else{
+                score -= opt.polyA_pen;
+            }
+            if (score > max){
+                max = score;
+                max_j = j;
+            }else if (max - score > opt.polyA_drop){
+                break;
+            }
+        }
+        int64_t polyA_len {length - max_j};
+        int64_t polyA_max {max};
+
+        score = 0;
+        max = 0;
+        max_j = -1;
+        for (int64_t j {0}; j < length; j++){
+            char c {int_seq.data[j]};
+            if (c == 'T' || c == 't'){
+                score++;
+            }else{
+                score -= opt.polyA_pen;
+            }
+            if (score > max){
+                max = score;
+                max_j = j;
+            }else if (max - score > opt.polyA_drop){
+                break;
+            }
+        }
+        int64_t polyT_len {max_j + 1};
+        int64_t polyT_max {max};
+
+        return polyA_max >= polyT_max ? polyA_len : -polyT_len;
+    }
+
+    // reverse complement that keeps only lowercase bases, as in gafcall.js
+    void append_reverse_complement(std::string& out, const TextSpan& s){
+        for (size_t i {s.size}; i > 0; i--){
+            switch (s.data[i - 1]){
+                case 'a': out += 't'; break;
+                case 't': out += 'a'; break;
+                case 'g': out += 'c'; break;
+                case 'c': out += 'g'; break;
+                default: break;
+            }
+        }
+    }
+
+    // converts an offset on the path to a segment and contig position; k only moves forward between calls
+    bool path_to_contig(const std::vector<PathSegment>& segments, int64_t path_off, bool is_end, size_t& k, ContigOffset& result){
+        if (is_end){
+            while (k < segments.size() && segments[k].path_en < path_off){
+                k++;
+            }
+        }else{
+            while (k < segments.size() && segments[k].path_en <= path_off){
+                k++;
+            }
+        }
+        if (k == segments.size()){
+            return false;
+        }
+        int64_t l {path_off - segments[k].path_st};
+        result.seg = k;
+        result.pos = segments[k].strand > 0 ? segments[k].ctg_st + l : segments[k].ctg_en - l;
+        return true;
+    }
+
+    // Parses one PAF line; returns false with an error message for input that cannot be processed.
+    // keep is false for alignments that are filtered out (low MAPQ, secondary, no CIGAR)
+    bool parse_alignment(const ExtractOptions& opt, const std::vector<TextSpan>& t, Alignment& y, bool& keep, std::string& error){
+        keep = false;
+        if (t.size() < 12 || !(equals(t[4], "+") || equals(t[4], "-"))){
+            // SAM records are not supported by the original script either
+            if (t[0].size > 0 && t[0].data[0] == '@'){
+                return true;
+            }
+            if ((parse_int(t[1]) & 0x100) != 0 || parse_int(t[4]) < opt.min_mapq){
+                return true;
+            }
+            error = "SAM input is not supported";
+            return false;
+        }
+
+        y.qname = t[0];
+        y.mapq = parse_int(t[11]);
+        if (y.mapq < opt.min_mapq){
+            return true;
+        }
+        y.qlen = parse_int(t[1]);
+        y.qst = parse_int(t[2]);
+        y.qen = parse_int(t[3]);
+        y.strand = t[4].data[0];
+        y.path = t[5];
+        y.tlen = parse_int(t[6]);
+        y.tst = parse_int(t[7]);
+        y.ten = parse_int(t[8]);
+
+        TextSpan tp {nullptr, 0};
+        bool has_cigar {false};
+        y.has_ds = false;
+        for (size_t i {12}; i < t.size(); i++){
+            if (starts_with(t[i], "cg:Z:")){
+                y.cigar = TextSpan{t[i].data + 5, t[i].size - 5};
+                has_cigar = true;
+            }else if (starts_with(t[i], "ds:Z:")){
+                y.ds = TextSpan{t[i].data + 5, t[i].size - 5};
+                y.has_ds = y.ds.size > 0;
+            }else if (starts_with(t[i], "tp:A:")){
+                tp = TextSpan{t[i].data + 5, t[i].size - 5};
+            }
+        }
+        keep = tp.data != nullptr && equals(tp, "P") && has_cigar;
+        return true;
+    }
+
+    /* Reports long INDELs contained in the CIGARs of one query's alignments */
+    bool get_indel(const ExtractOptions& opt, const RegionMask& mask, Workspace& ws, std::string& out, std::string& error){
+        for (auto it = ws.group.begin(); it != ws.group.end(); it++){
+            const Alignment& y {*it};
+            if (static_cast<double>(y.qen - y.qst) < static_cast<double>(y.qlen) * opt.min_frac){
+                continue;
+            }
+            bool is_rev {y.strand == '-'};
+
+            // collect the list of long indels
+            std::vector<LongIndel>& a {ws.indels};
+            a.clear();
+            int64_t x {y.tst};
+            int64_t q {0};
+            for_each_cigar_op(y.cigar, [&](int64_t len, char op){
+                if (len >= opt.min_len){
+                    LongIndel indel;
+                    std::memset(&indel, 0, sizeof(indel));
+                    if (op == 'I'){
+                        int64_t qoff {is_rev ? y.qen - (q + len) : q + y.qst};
+                        indel.st = x;
+                        indel.en = x;
+                        indel.len = len;
+                        indel.qoff_l = qoff;
+                        indel.qoff_r = qoff + len;
+                        a.push_back(indel);
+                    }else if (op == 'D'){
+                        int64_t qoff {is_rev ? y.qen - q : q + y.qst};
+                        indel.st = x;
+                        indel.en = x + len;
+                        indel.len = -len;
+                        indel.qoff_l = qoff;
+                        indel.qoff_r = qoff;
+                        a.push_back(indel);
+                    }
+                }
+                if (op == 'M' || op == '=' || op == 'X' || op == 'D' || op == 'N'){
+                    x += len;
+                }
+                if (op == 'M' || op == '=' || op == 'X' || op == 'I' || op == 'S' || op == 'H'){
+                    q += len;
+                }
+            });
+            if (a.empty() || static_cast<double>(a.size()) > static_cast<double>(y.qlen) * 1e-4 * static_cast<double>(opt.max_cnt_10k)){
+                continue;
+            }
+            for (auto indel = a.begin(); indel != a.end(); indel++){
+                indel->stl = indel->str = indel->st;
+                indel->enl = indel->enr = indel->en;
+            }
+
+            // the INDEL sequences of ds:Z must match the long INDELs of the CIGAR
+            if (y.has_ds){
+                size_t i {0};
+                x = y.tst;
+                bool consistent {for_each_ds_op(y.ds, [&](char op, const TextSpan& text){
+                    int64_t len {0};
+                    if (op == ':'){
+                        len = parse_int(text);
+                    }else if (op == '*'){
+                        len = 1;
+                    }else{
+                        len = static_cast<int64_t>(text.size) - std::count(text.data, text.data + text.size, '[') - std::count(text.data, text.data + text.size, ']');
+                    }
+                    if (len >= opt.min_len && (op == '+' || op == '-')){
+                        if (i >= a.size() || a[i].st != x || a[i].en != (op == '+' ? x : x + len) || a[i].len != (op == '+' ? len : -len)){
+                            error = std::string("inconsistent ") + (op == '+' ? "insertion" : "deletion") + " in alignment of " + y.qname.str();
+                            return false;
+                        }
+                        a[i].has_seq = true;
+                        a[i++].indel_seq = text;
+                    }
+                    if (op == '*' || op == ':' || op == '-'){
+                        x += len;
+                    }
+                    return true;
+                })};
+                if (!consistent){
+                    return false;
+                }
+
+                // compute TSD and polyA lengths
+                for (auto indel = a.begin(); indel != a.end(); indel++){
+                    if (!indel->has_seq || !split_tsd(indel->indel_seq, indel->tsd_left, indel->int_seq, indel->tsd_right)){
+                        error = "INDEL of " + y.qname.str() + " has no sequence in ds:Z";
+                        return false;
+                    }
+                    indel->polyA_len = polyA_length(opt, indel->int_seq);
+                    int64_t llen {static_cast<int64_t>(indel->tsd_left.size)};
+                    int64_t rlen {static_cast<int64_t>(indel->tsd_right.size)};
+                    indel->stl = indel->st - rlen;
+                    indel->enl = indel->en - rlen;
+                    indel->str = indel->st + llen;
+                    indel->enr = indel->en + llen;
+                    if (is_rev){
+                        indel->qoff_l -= llen;
+                        indel->qoff_r += rlen;
+                    }else{
+                        indel->qoff_l -= rlen;
+                        indel->qoff_r += llen;
+                    }
+                }
+            }
+
+            // reference segments in the path
+            std::vector<PathSegment>& seg {ws.segments};
+            seg.clear();
+            if (contains_path_orientation(y.path)){
+                if (y.strand != '+'){
+                    error = "reverse strand on path in alignment of " + y.qname.str();
+                    return false;
+                }
+                int64_t path_x {0};
+                for_each_path_segment(y.path, [&](char ori, const TextSpan& ctg, int64_t st, int64_t en){
+                    seg.push_back(PathSegment{ctg, st, en, ori == '>' ? 1 : -1, path_x, path_x + (en - st)});
+                    path_x += en - st;
+                });
+            }else{
+                seg.push_back(PathSegment{y.path, 0, y.tlen, 1, 0, y.tlen});
+            }
+
+            // convert stl, enl, str and enr from path to contig offsets
+            for (int kind {0}; kind < 4; kind++){
+                size_t k {0};
+                bool is_end {kind == 1 || kind == 3};
+                for (auto indel = a.begin(); indel != a.end(); indel++){
+                    int64_t path_off {kind == 0 ? indel->stl : kind == 1 ? indel->enl : kind == 2 ? indel->str : indel->enr};
+                    if (!path_to_contig(seg, path_off, is_end, k, indel->ctg_offsets[kind])){
+                        error = "failed to convert path offset to contig offset for read " + y.qname.str();
+                        return false;
+                    }
+                }
+            }
+
+            for (auto indel = a.begin(); indel != a.end(); indel++){
+                const ContigOffset& stl {indel->ctg_offsets[0]};
+                const ContigOffset& enl {indel->ctg_offsets[1]};
+                const ContigOffset& str {indel->ctg_offsets[2]};
+                const ContigOffset& enr {indel->ctg_offsets[3]};
+                // all on the same segment
+                if (!(stl.seg == str.seg && stl.seg == enl.seg && str.seg == enr.seg)){
+                    continue;
+                }
+                const PathSegment& s {seg[stl.seg]};
+                int64_t st {stl.pos};
+                int64_t en {enl.pos};
+                int64_t polyA_len {indel->polyA_len};
+                char strand {y.strand};
+
+                // TSD sequence is the right TSD followed by the left TSD
+                ws.tsd_seq.clear();
+                ws.int_seq.clear();
+                if (!y.has_ds){
+                    ws.tsd_seq = ".";
+                    ws.int_seq = ".";
+                }
+                if (s.strand < 0){
+                    // reverse complement tsd, polyA and insert
+                    polyA_len = -polyA_len;
+                    if (y.has_ds){
+                        append_reverse_complement(ws.tsd_seq, indel->tsd_left);
+                        append_reverse_complement(ws.tsd_seq, indel->tsd_right);
+                        append_reverse_complement(ws.int_seq, indel->int_seq);
+                    }else{
+                        ws.tsd_seq.clear();
+                        ws.int_seq.clear();
+                    }
+                    st = enr.pos;
+                    en = str.pos;
+                    strand = y.strand == '+' ? '-' : '+';
+                }else if (y.has_ds){
+                    append(ws.tsd_seq, indel->tsd_right);
+                    append(ws.tsd_seq, indel->tsd_left);
+                    append(ws.int_seq, indel->int_seq);
+                }
+
+                append(out, s.ctg);
+                out += '\t';
+                append_int(out, st);
+                out += '\t';
+                append_int(out, en);
+                out += '\t';
+                append(out, y.qname);
+                out += '\t';
+                append_int(out, y.mapq);
+                out += '\t';
+                out += strand;
+                out += indel->len > 0 ? "\tSVTYPE=INS;SVLEN=" : "\tSVTYPE=DEL;SVLEN=";
+                append_int(out, indel->len);
+                out += ";qoff_l=";
+                append_int(out, indel->qoff_l);
+                out += ";qoff_r=";
+                append_int(out, indel->qoff_r);
+                out += ";tsd_len=";
+                append_int(out, static_cast<int64_t>(indel->tsd_left.size + indel->tsd_right.size));
+                out += ";polyA_len=";
+                append_int(out, polyA_len);
+                if (mask.find_contig(s.ctg) >= 0){
+                    out += ";cen_dist=";
+                    append_int(out, std::min(mask.distance(s.ctg, st), mask.distance(s.ctg, en)));
+                }
+                out += ";source=";
+                out += opt.name;
+                out += ";tsd_seq=";
+                out += ws.tsd_seq.empty() ? "." : ws.tsd_seq;
+                out += ";insert=";
+                out += ws.int_seq.empty() ? "." : ws.int_seq;
+                out += '\n';
+            }
+        }
+        return true;
+    }
+
+    /* Finds the reference coordinates of both ends of an alignment */
+    bool get_end_coor(Alignment& y, std::string& error){
+        y.ends[0].ql = y.ends[1].ql = y.qen - y.qst;
+        if (y.path.size > 0 && (y.path.data[0] == '>' || y.path.data[0] == '<')){
+            if (y.strand != '+'){
+                error = "reverse strand on path in alignment of " + y.qname.str();
+                return false;
+            }
+            int64_t x {0};
+            bool found[2] {false, false};
+            for_each_path_segment(y.path, [&](char ori, const TextSpan& ctg, int64_t st, int64_t en){
+                int64_t len {en - st};
+                if (y.tst >= x && y.tst < x + len){
+                    y.ends[0].ctg = ctg;
+                    y.ends[0].ori = ori;
+                    y.ends[0].pos = ori == '>' ? st + (y.tst - x) : st + (x + len - y.tst) - 1;
+                    found[0] = true;
+                }
+                if (y.ten > x && y.ten <= x + len){
+                    y.ends[1].ctg = ctg;
+                    y.ends[1].ori = ori;
+                    y.ends[1].pos = ori == '>' ? st + (y.ten - x) - 1 : st + (x + len - y.ten);
+                    found[1] = true;
+                }
+                x += len;
+            });
+            if (!found[0] || !found[1]){
+                error = "alignment ends are outside of the path for read " + y.qname.str();
+                return false;
+            }
+        }else{
+            char ori {y.strand == '+' ? '>' : '<'};
+            y.ends[0].ctg = y.ends[1].ctg = y.path;
+            y.ends[0].ori = y.ends[1].ori = ori;
+            y.ends[0].pos = y.strand == '+' ? y.tst : y.ten - 1;
+            y.ends[1].pos = y.strand == '+' ? y.ten - 1 : y.tst;
+        }
+        return true;
+    }
+
+    /* Classifies the SV between two alignment ends; c0 must have the smaller coordinate */
+    bool infer_svtype(const ExtractOptions& opt, const EndCoordinate& c0, const EndCoordinate& c1, const char* ori, int64_t qgap, int64_t& st, int64_t& en, std::string& info, std::string& error){
+        st = -1;
+        en = -1;
+        info = "SVTYPE=BND";
+        if (!equals(c0.ctg, c1.ctg)){
+            return true;
+        }
+        int64_t l {c1.pos - c0.pos + 1};
+        if (l < 0){
+            error = "breakpoint ends are out of order";
+            return false;
+        }
+        bool same_ori {ori[0] == ori[1]};
+        if (same_ori && ori[0] == '>' && qgap < l && l - qgap >= opt.min_len){
+            // deletion
+            st = qgap < 0 ? c0.pos + qgap : c0.pos;
+            en = qgap < 0 ? c1.pos + 1 - qgap : c1.pos + 1;
+            info = "SVTYPE=DEL;SVLEN=";
+            append_int(info, -(l - qgap));
+            info += ";sv_region=";
+            append_int(info, st);
+            info += ',';
+            append_int(info, en);
+            info += ";tsd_len=";
+            append_int(info, qgap < 0 ? -qgap : 0);
+        }else if (same_ori && ori[0] == '>' && l < qgap && qgap - l >= opt.min_len){
+            // insertion without TSD
+            st = c0.pos;
+            en = c1.pos + 1;
+            info = "SVTYPE=INS;SVLEN=";
+            append_int(info, qgap - l);
+            info += ";sv_region=";
+            append_int(info, st);
+            info += ',';
+            append_int(info, en);
+        }else if (same_ori && ori[0] == '<' && qgap > 0 && (l < c0.ql || l < c1.ql) && qgap + l >= opt.min_len){
+            // insertion with TSD
+            st = c0.pos;
+            en = c1.pos + 1;
+            info = "SVTYPE=INS;SVLEN=";
+            append_int(info, qgap + l);
+            info += ";sv_region=";
+            append_int(info, st);
+            info += ',';
+            append_int(info, en);
+            info += ";tsd_len=";
+            append_int(info, l);
+        }else if (same_ori && ori[0] == '<' && qgap + l >= opt.min_len){
+            // tandem duplication; similar to insertion with TSD
+            st = qgap < 0 ? c0.pos : c0.pos > qgap ? c0.pos - qgap : 0;
+            en = qgap < 0 ? c1.pos + 1 : c1.pos + 1 + qgap;
+            info = "SVTYPE=DUP;SVLEN=";
+            append_int(info, qgap + l);
+            info += ";sv_region=";
+            append_int(info, st);
+            info += ',';
+            append_int(info, en);
+        }else if (!same_ori && l >= opt.min_len){
+            // inversion
+            st = qgap < 0 ? c0.pos + qgap : c0.pos;
+            en = qgap < 0 ? c1.pos + 1 - qgap : c1.pos + 1;
+            info = "SVTYPE=INV;SVLEN=";
+            append_int(info, l - qgap);
+            info += ";sv_region=";
+            append_int(info, st);
+            info += ',';
+            append_int(info, en);
+        }
+        return true;
+    }
+
+    /* Reports breakpoints between consecutive alignments of one query */
+    bool get_breakpoint(const ExtractOptions& opt, const RegionMask& mask, Workspace& ws, std::string& out, std::string& error){
+        std::vector<Alignment>& z {ws.group};
+        if (z.size() < 2){
+            return true;
+        }
+        // sort by start position on the read
+        std::stable_sort(z.begin(), z.end(), [](const Alignment& a, const Alignment& b){
+            return a.qst < b.qst;
+        });
+
+        // filter out short alignments towards the end of the read
+        size_t zen {z.size()};
+        for (size_t j {z.size()}; j > 0; j--){
+            const Alignment& y {z[j - 1]};
+            if (y.qen - y.qst < opt.min_aln_len_end || y.mapq < opt.min_mapq_end){
+                zen = j - 1;
+            }else{
+                break;
+            }
+        }
+        if (zen < 2){
+            return true;
+        }
+        // filter out short alignments towards the start of the read
+        size_t zst {0};
+        for (size_t j {0}; j < zen; j++){
+            const Alignment& y {z[j]};
+            if (y.qen - y.qst < opt.min_aln_len_end || y.mapq < opt.min_mapq_end){
+                zst = j + 1;
+            }else{
+                break;
+            }
+        }
+        if (zen < zst + 2){
+            return true;
+        }
+
+        std::vector<const Alignment*>& zz {ws.kept};
+        zz.clear();
+        for (size_t j {zst}; j < zen; j++){
+            if (z[j].qen - z[j].qst >= opt.min_aln_len_mid){
+                if (!get_end_coor(z[j], error)){
+                    return false;
+                }
+                zz.push_back(&z[j]);
+            }
+        }
+        if (zz.size() < 2){
+            return true;
+        }
+
+        for (size_t j {1}; j < zz.size(); j++){
+            const Alignment& y0 {*zz[j - 1]};
+            const Alignment& y1 {*zz[j]};
+            int64_t qgap {y1.qst - y0.qen};
+            const EndCoordinate* c0 {&y0.ends[1]};
+            const EndCoordinate* c1 {&y1.ends[0]};
+            char strand2 {'+'};
+            char ori[3] {c0->ori, c1->ori, '\0'};
+            if (!(less_than(c0->ctg, c1->ctg) || (equals(c0->ctg, c1->ctg) && c0->pos < c1->pos))){
+                c0 = &y1.ends[0];
+                c1 = &y0.ends[1];
+                strand2 = '-';
+                ori[0] = c1->ori == '>' ? '<' : '>';
+                ori[1] = c0->ori == '>' ? '<' : '>';
+            }
+            int64_t sv_st;
+            int64_t sv_en;
+            if (!infer_svtype(opt, *c0, *c1, ori, qgap, sv_st, sv_en, ws.sv_info, error)){
+                return false;
+            }
+
+            append(out, c0->ctg);
+            out += '\t';
+            append_int(out, c0->pos);
+            out += '\t';
+            out += ori;
+            out += '\t';
+            append(out, c1->ctg);
+            out += '\t';
+            append_int(out, c1->pos);
+            out += '\t';
+            append(out, y0.qname);
+            out += '\t';
+            append_int(out, std::min(y0.mapq, y1.mapq));
+            out += '\t';
+            out += strand2;
+            out += '\t';
+            out += ws.sv_info;
+            out += ";qoff_l=";
+            append_int(out, std::min(y0.qen, y1.qst));
+            out += ";qoff_r=";
+            append_int(out, std::max(y0.qen, y1.qst));
+            out += ";qgap=";
+            append_int(out, qgap);
+            out += ";mapq=";
+            append_int(out, y0.mapq);
+            out += ',';
+            append_int(out, y1.mapq);
+            out += ";aln_len=";
+            append_int(out, y0.qen - y0.qst);
+            out += ',';
+            append_int(out, y1.qen - y1.qst);
+            if (mask.find_contig(c0->ctg) >= 0 || mask.find_contig(c1->ctg) >= 0){
+                out += ";cen_dist=";
+                append_int(out, std::min(mask.distance(c0->ctg, c0->pos), mask.distance(c1->ctg, c1->pos)));
+                if (sv_st >= 0 && sv_en >= sv_st){
+                    out += ";cen_overlap=";
+                    append_int(out, mask.overlap(c0->ctg, sv_st, sv_en));
+                }
+            }
+            out += ";source=";
+            out += opt.name;
+            out += '\n';
+        }
+        return true;
+    }
+
+    /* Parses and extracts the SVs of one query's alignments, given as consecutive PAF lines */
+    bool process_query(const ExtractOptions& opt, const RegionMask& mask, const TextSpan* lines, size_t num_lines, Workspace& ws, std::string& out, std::string& error){
+        ws.group.clear();
+        for (size_t i {0}; i < num_lines; i++){
+            ws.fields.clear();
+            const char* line_end {lines[i].data + lines[i].size};
+            const char* field_start {lines[i].data};
+            while (true){
+                const char* tab {static_cast<const char*>(std::memchr(field_start, '\t', static_cast<size_t>(line_end - field_start)))};
+                const char* field_end {tab == nullptr ? line_end : tab};
+                ws.fields.push_back(TextSpan{field_start, static_cast<size_t>(field_end - field_start)});
+                if (tab == nullptr){
+                    break;
+                }
+                field_start = tab + 1;
+            }
+
+            Alignment y;
+            std::memset(&y, 0, sizeof(y));
+            bool keep;
+            if (!parse_alignment(opt, ws.fields, y, keep, error)){
+                return false;
+            }
+            if (keep){
+                ws.group.push_back(y);
+            }
+        }
+
+        return get_indel(opt, mask, ws, out, error) && get_breakpoint(opt, mask, ws, out, error);
+    }
+}
+
+ExtractOptions::ExtractOptions() : min_mapq(5), min_mapq_end(30), min_frac(0.7), min_len(100), min_aln_len_end(2000), min_aln_len_mid(50), max_cnt_10k(3), polyA_pen(5), polyA_drop(100), name("foo"){}
+
+bool sv_extract::extract(const char* begin, const char* end, const ExtractOptions& opt, const RegionMask& mask, unsigned num_threads, const std::function<void(const TextSpan&, const char*, size_t)>& consume_query){
+    // group the alignment lines (at least 11 columns) into runs with the same query name
+    std::vector<TextSpan> lines;
+    std::vector<size_t> group_starts;
+    TextSpan group_qname {nullptr, 0};
+    const char* line {begin};
+    while (line < end){
+        const char* newline {static_cast<const char*>(std::memchr(line, '\n', static_cast<size_t>(end - line)))};
+        const char* line_end {newline == nullptr ? end : newline};
+
+        size_t num_tabs {0};
+        const char* qname_end {line_end};
+        for (const char* p {line}; num_tabs < 10 && p < line_end; p++){
+            p = static_cast<const char*>(std::memchr(p, '\t', static_cast<size_t>(line_end - p)));
+            if (p == nullptr){
+                break;
+            }
+            if (num_tabs++ == 0){
+                qname_end = p;
+            }
+        }
+        if (num_tabs >= 10){
+            TextSpan qname {line, static_cast<size_t>(qname_end - line)};
+            if (group_starts.empty() || !equals(qname, group_qname)){
+                group_starts.push_back(lines.size());
+                group_qname = qname;
+            }
+            lines.push_back(TextSpan{line, static_cast<size_t>(line_end - line)});
+        }
+        line = line_end + 1;
+    }
+    group_starts.push_back(lines.size());
+
+    // queries are handed to the workers in batches, and each batch's output is written in input order
+    size_t num_groups {group_starts.size() - 1};
+    size_t groups_per_task {std::max<size_t>(1, num_groups / (static_cast<size_t>(num_threads) * 32))};
+    size_t num_tasks {(num_groups + groups_per_task - 1) / groups_per_task};
+    std::vector<Workspace> workspaces(num_threads);
+    std::vector<std::string> outputs(num_tasks);
+    std::vector<std::vector<size_t>> output_ends(num_tasks);
+    std::vector<std::string> errors(num_tasks);
+
+    auto work = [&](unsigned worker_id, size_t task){
+        size_t last_group {std::min(num_groups, (task + 1) * groups_per_task)};
+        for (size_t g {task * groups_per_task}; g < last_group; g++){
+            if (!process_query(opt, mask, &lines[group_starts[g]], group_starts[g + 1] - group_starts[g], workspaces[worker_id], outputs[task], errors[task])){
+                break;
+            }
+            output_ends[task].push_back(outputs[task].size());
+        }
+    };
+    auto consume = [&](size_t task){
+        size_t output_start {0};
+        for (size_t g {0}; g < output_ends[task].size(); g++){
+            if (output_ends[task][g] == output_start){
+                continue;
+            }
+            const TextSpan& first_line {lines[group_starts[task * groups_per_task + g]]};
+            TextSpan qname {first_line.data, static_cast<size_t>(static_cast<const char*>(std::memchr(first_line.data, '\t', first_line.size)) - first_line.data)};
+            consume_query(qname, outputs[task].data() + output_start, output_ends[task][g] - output_start);
+            output_start = output_ends[task][g];
+        }
+        std::string().swap(outputs[task]);
+        std::vector<size_t>().swap(output_ends[task]);
+        if (!errors[task].empty()){
+            std::cout << "[sv_extract::extract][ERROR] " << errors[task] << '\n';
+            return false;
+        }
+        return true;
+    };
+    return run_in_order(num_tasks, num_threads, work, consume);
+}
+
+bool sv_extract::extract_svs(ArgumentParser& user_args, const RegionMask& mask, const std::unordered_map<std::string, size_t>& kept_ks, StageMetrics& metrics){
+    ExtractOptions opt;
+    opt.min_mapq = std::stoll(user_args.args["-q"]);
+    opt.min_mapq_end = std::stoll(user_args.args["-Q"]);
+    opt.min_mapq = std::min(opt.min_mapq, opt.min_mapq_end);
+
+    std::string paf_path {user_args.args["-o"] + "/intermediate_output/candidate_svs_without_mask.paf"};
+    MappedFile paf_file;
+    if (!paf_file.open(paf_path)){
+        std::cout << "[sv_extract::extract_svs][ERROR] could not open candidate alignments: " << paf_path << '\n';
+        return false;
+    }
+
+    // all four call sets of every k are written while the SVs are extracted; a sweep over several k values puts each k's call sets in <-o>/k<k>
+    std::vector<int> ks {topology_search::k_values(user_args)};
+    std::vector<std::unique_ptr<CallSetWriter>> out_calls;
+    for (auto it = ks.begin(); it != ks.end(); it++){
+        std::string out_dir {user_args.args["-o"]};
+        if (ks.size() > 1){
+            out_dir += "/k" + std::to_string(*it);
+            if (mkdir(out_dir.c_str(), 0755) != 0 && errno != EEXIST){
+                std::cout << "[sv_extract::extract_svs][ERROR] could not create output directory " << out_dir << '\n';
+                return false;
+            }
+        }
+        out_calls.emplace_back(new CallSetWriter());
+        if (!out_calls.back()->open(out_dir, user_args.args["--compress"] == "bgzf")){
+            return false;
+        }
+    }
+
+    // the SVs of a unitig go to the call sets of the k values it passed the topology search for
+    unsigned threads {static_cast<unsigned>(std::stoul(user_args.args["-t"]))};
+    std::string qname;
+    uint64_t num_queries {0};
+    uint64_t num_records {0};
+    uint64_t num_written {0};
+    bool extracted {extract(paf_file.data(), paf_file.data() + paf_file.size(), opt, mask, threads, [&](const TextSpan& query, const char* records, size_t size){
+        qname.assign(query.data, query.size);
+        auto kept = kept_ks.find(qname);
+        size_t num_kept {kept == kept_ks.end() ? 0 : kept->second};
+        for (size_t i{0}; i < num_kept && i < out_calls.size(); i++){
+            out_calls[i]->write(records, size);
+        }
+        uint64_t query_records {static_cast<uint64_t>(std::count(records, records + size, '\n'))};
+        num_queries++;
+        num_records += query_records;
+        num_written += query_records * std::min(num_kept, out_calls.size());
+    })};
+    metrics.bytes_read = paf_file.size();
+    metrics.add_count("queries_with_svs", num_queries);
+    metrics.add_count("sv_records", num_records);
+    metrics.add_count("sv_records_written", num_written);
+
+    bool closed {true};
+    for (auto it = out_calls.begin(); it != out_calls.end(); it++){
+        closed = (*it)->close() && closed;
+    }
+    if (!closed){
+        std::cout << "[sv_extract::extract_svs][ERROR] could not write call sets to " << user_args.args["-o"] << '\n';
+        return false;
+    }
+    return extracted;
+}
@@ -0,0 +1,44 @@
+#ifndef SV_EXTRACT_H
+#define SV_EXTRACT_H
+
+#include "argument_parser.h"
+#include "call_writer.h"
+#include "gfa_scanner.h"
+#include "region_mask.h"
+#include "run_metrics.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Settings of the long INDEL and breakpoint extraction, with the defaults of gafcall.js extract
+struct ExtractOptions{
+	ExtractOptions();
+
+	int64_t min_mapq;
+	int64_t min_mapq_end;
+	double min_frac;
+	int64_t min_len;
+	int64_t min_aln_len_end;
+	int64_t min_aln_len_mid;
+	int64_t max_cnt_10k;
+	int64_t polyA_pen;
+	int64_t polyA_drop;
+	std::string name;
+};
+
+namespace sv_extract{
+	// extracts long INDELs and alignment breakpoints from the alignments of the final candidate unitigs into the call sets
+	// of each k value the unitig passed the topology search for (kept_ks as filled by run_topology_search)
+	bool extract_svs(ArgumentParser& user_args, const RegionMask& mask, const std::unordered_map<std::string, size_t>& kept_ks, StageMetrics& metrics);
+
+	// extracts the SVs of the alignments in [begin, end) in the format of gafcall.js extract, and hands the SVs of each
+	// query (if any) to consume_query(qname, records, size) in input order; alignments of the same query must be on
+	// consecutive lines, and queries are processed in parallel
+	bool extract(const char* begin, const char* end, const ExtractOptions& opt, const RegionMask& mask, unsigned num_threads, const std::function<void(const TextSpan&, const char*, size_t)>& consume_query);
+}
+
+#endif
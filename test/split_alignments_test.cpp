@@ -0,0 +1,66 @@
+// Regression test of topology_search::get_split_alignments: a unitig with more than one primary alignment is a candidate
+// wherever its block is in the PAF file, including the last block, which the line-by-line parser used to drop
+#include "../paf_store.h"
+#include "../run_metrics.h"
+#include "../topology_search.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace{
+    const char* paf_path {"test/split_alignments_test.paf"};
+
+    std::string alignment(const std::string& query, const std::string& target, char type){
+        return query + "\t10000\t0\t5000\t+\t" + target + "\t248000000\t1000\t6000\t5000\t5000\t60\tNM:i:0\tms:i:0\tAS:i:0\tnn:i:0\ttp:A:" + type + "\tcg:Z:5000M";
+    }
+
+    // writes the records (without a newline after the last one if trailing_newline is false) and returns the candidates
+    bool split_candidates(const std::vector<std::string>& records, bool trailing_newline, std::unordered_set<std::string>& candidates){
+        std::ofstream paf(paf_path);
+        for (size_t i{0}; i < records.size(); i++){
+            paf << records[i];
+            if (i + 1 < records.size() || trailing_newline){
+                paf << '\n';
+            }
+        }
+        paf.close();
+
+        PafStore alignments;
+        RunMetrics metrics("test");
+        candidates.clear();
+        bool ok {alignments.open(paf_path) && topology_search::get_split_alignments(alignments, candidates, metrics.begin_stage("split_alignments"))};
+        std::remove(paf_path);
+        return ok;
+    }
+
+    bool check(const std::string& name, bool passed){
+        std::cout << (passed ? "[PASS] " : "[FAIL] ") << name << '\n';
+        return passed;
+    }
+}
+
+int main(){
+    bool passed {true};
+    std::unordered_set<std::string> candidates;
+
+    // the split unitig is the last block of the file
+    std::vector<std::string> last_block_split {alignment("utg000001l", "chr1", 'P'), alignment("utg000002l", "chr1", 'P'), alignment("utg000002l", "chr2", 'S'),
+        alignment("utg020060l", "chr1", 'P'), alignment("utg020060l", "chr3", 'P')};
+    passed &= check("split alignment in the last block", split_candidates(last_block_split, true, candidates) && candidates == std::unordered_set<std::string>{"utg020060l"});
+    passed &= check("split alignment in the last block without a final newline", split_candidates(last_block_split, false, candidates) && candidates == std::unordered_set<std::string>{"utg020060l"});
+
+    // split unitigs in the first and a middle block, and a last block with one primary and one secondary alignment
+    std::vector<std::string> inner_splits {alignment("utg000001l", "chr1", 'P'), alignment("utg000001l", "chr2", 'P'), alignment("utg000002l", "chr1", 'P'),
+        alignment("utg000003l", "chr2", 'P'), alignment("utg000003l", "chr2", 'S'), alignment("utg000003l", "chr3", 'P'), alignment("utg000004l", "chr1", 'P'), alignment("utg000004l", "chr1", 'S')};
+    passed &= check("split alignments before the last block", split_candidates(inner_splits, true, candidates) && candidates == std::unordered_set<std::string>{"utg000001l", "utg000003l"});
+
+    // a file with a single split unitig is all last block
+    passed &= check("single split block", split_candidates({alignment("utg000001l", "chr1", 'P'), alignment("utg000001l", "chr2", 'P')}, true, candidates) && candidates.size() == 1);
+    passed &= check("empty alignment file", split_candidates({}, true, candidates) && candidates.empty());
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+#include "thread_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <utility>
+
+WorkStealingPool::WorkStealingPool(size_t num_tasks, unsigned num_threads, std::function<void(unsigned, size_t)> task) : task(std::move(task)), ranges(), workers(){
+    if (num_threads == 0){
+        num_threads = 1;
+    }
+
+    // split the tasks into equal contiguous ranges, one per worker
+    for (unsigned i{0}; i < num_threads; i++){
+        ranges.emplace_back(new TaskRange());
+        ranges.back()->begin = num_tasks * i / num_threads;
+        ranges.back()->end = num_tasks * (i + 1) / num_threads;
+    }
+
+    for (unsigned i{0}; i < num_threads; i++){
+        workers.emplace_back(&WorkStealingPool::work, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool(){
+    join();
+}
+
+void WorkStealingPool::join(){
+    for (auto it = workers.begin(); it != workers.end(); it++){
+        if (it->joinable()){
+            it->join();
+        }
+    }
+}
+
+void WorkStealingPool::work(unsigned worker_id){
+    size_t index;
+    while (take(worker_id, index) || (steal(worker_id) && take(worker_id, index))){
+        task(worker_id, index);
+    }
+}
+
+// Takes the next index from the front of this worker's own range
+bool WorkStealingPool::take(unsigned worker_id, size_t& index){
+    TaskRange& own {*ranges[worker_id]};
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (own.begin == own.end){
+        return false;
+    }
+    index = own.begin++;
+    return true;
+}
+
+// Moves the back half of the largest remaining range to this worker; returns false once all work is handed out
+bool WorkStealingPool::steal(unsigned worker_id){
+    while (true){
+        size_t victim {worker_id};
+        size_t most_left {0};
+        for (size_t i{0}; i < ranges.size(); i++){
+            std::lock_guard<std::mutex> guard(ranges[i]->lock);
+            if (ranges[i]->end - ranges[i]->begin > most_left){
+                most_left = ranges[i]->end - ranges[i]->begin;
+                victim = i;
+            }
+        }
+        if (most_left == 0){
+            return false;
+        }
+
+        size_t stolen_begin, stolen_end;
+        {
+            TaskRange& other {*ranges[victim]};
+            std::lock_guard<std::mutex> guard(other.lock);
+            if (other.begin == other.end){
+                // the victim finished its range in the meantime, so look again
+                continue;
+            }
+            stolen_end = other.end;
+            stolen_begin = other.begin + (other.end - other.begin) / 2;
+            other.end = stolen_begin;
+        }
+
+        TaskRange& own {*ranges[worker_id]};
+        std::lock_guard<std::mutex> guard(own.lock);
+        own.begin = stolen_begin;
+        own.end = stolen_end;
+        return true;
+    }
+}
+
+bool run_in_order(size_t num_tasks, unsigned num_threads, const std::function<void(unsigned, size_t)>& work, const std::function<bool(size_t)>& consume){
+    std::vector<char> finished(num_tasks, 0);
+    std::mutex finished_lock;
+    std::condition_variable finished_signal;
+    std::atomic<bool> stopped {false};
+
+    WorkStealingPool pool(num_tasks, num_threads, [&](unsigned worker_id, size_t i){
+        if (!stopped){
+            work(worker_id, i);
+        }
+        std::lock_guard<std::mutex> guard(finished_lock);
+        finished[i] = 1;
+        finished_signal.notify_one();
+    });
+
+    for (size_t i{0}; i < num_tasks && !stopped; i++){
+        {
+            std::unique_lock<std::mutex> lock(finished_lock);
+            finished_signal.wait(lock, [&]{ return finished[i] != 0; });
+        }
+        if (!consume(i)){
+            stopped = true;
+        }
+    }
+    pool.join();
+    return !stopped;
+}
@@ -0,0 +1,44 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs task(worker_id, index) for every index in [0, num_tasks) on a fixed set of threads
+// each worker starts with a contiguous range of indices and processes it from the front;
+// when its range is empty it steals the back half of the largest remaining range
+class WorkStealingPool{
+	public:
+		WorkStealingPool(size_t num_tasks, unsigned num_threads, std::function<void(unsigned, size_t)> task);
+		~WorkStealingPool();
+		WorkStealingPool(const WorkStealingPool&) = delete;
+		WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+		void join();
+
+	private:
+		struct TaskRange{
+			TaskRange() : lock(), begin(0), end(0){}
+			std::mutex lock;
+			size_t begin;
+			size_t end;
+		};
+
+		void work(unsigned worker_id);
+		bool take(unsigned worker_id, size_t& index);
+		bool steal(unsigned worker_id);
+
+		std::function<void(unsigned, size_t)> task;
+		std::vector<std::unique_ptr<TaskRange>> ranges;
+		std::vector<std::thread> workers;
+};
+
+// Runs work(worker_id, index) for every index in [0, num_tasks) on a WorkStealingPool, and consume(index) on the
+// calling thread in index order as soon as each task is done; once consume returns false the remaining tasks are skipped
+bool run_in_order(size_t num_tasks, unsigned num_threads, const std::function<void(unsigned, size_t)>& work, const std::function<bool(size_t)>& consume);
+
+#endif
@@ -1,23 +1,30 @@
 #include "argument_parser.h"
+#include "gfa_scanner.h"
+#include "thread_pool.h"
 #include "topology_search.h"
 
-#include <assert.h>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <queue>
 #include <sstream>
+#include <vector>
 
 /* Checks that the user input all required flags */
 bool topology_search::check_args(ArgumentParser& user_args){
-    // check required flags
-    std::list<std::string> required {"-o", "--graph", "--filter"};
+    // check required flags; merge only combines the results of the shards of a call, and does not read the graph
+    bool merging {user_args.args["command"] == "merge"};
+    std::list<std::string> required {"-o", merging ? "--shards" : "--graph", "--filter"};
     if (!user_args.check_required_flags(required)){
         return false;
     }
 
-    if (!user_args.check_file("--graph", ".gfa")){
+    if (!merging && !user_args.check_file("--graph", ".gfa", true)){
         std::cout << "[topology_search::check_args][ERROR] invalid graph file: " << user_args.args["--graph"] << '\n';
         return false;
     }
@@ -30,6 +37,17 @@ bool topology_search::check_args(ArgumentParser& user_args){
     if (user_args.args.count("-k") == 0){
         user_args.args.insert({"-k", "10"});
     }
+    // several comma separated k values run a sweep with one call set per k
+    std::istringstream k_list(user_args.args["-k"]);
+    std::string k_value;
+    while (std::getline(k_list, k_value, ',')){
+        char* k_end {nullptr};
+        std::strtol(k_value.c_str(), &k_end, 10);
+        if (k_value.empty() || *k_end != '\0'){
+            std::cout << "[topology_search::check_args][ERROR] -k must be an integer or a comma separated list of integers (e.g., 5,10,20)\n";
+            return false;
+        }
+    }
 
     if (user_args.args.count("-q") == 0){
         user_args.args.insert({"-q", "15"});
@@ -39,342 +57,909 @@ bool topology_search::check_args(ArgumentParser& user_args){
         user_args.args.insert({"-Q", "15"});
     }
 
-    if (user_args.args.count("--index-bin-size") == 0){
-        user_args.args.insert({"--index-bin-size", "100"});
+    if (user_args.args.count("-t") == 0){
+        user_args.args.insert({"-t", "3"});
+    }
+    if (std::stoi(user_args.args["-t"]) < 1){
+        std::cout << "[topology_search::check_args][ERROR] number of threads must be at least 1\n";
+        return false;
     }
-    return true;
-}
 
-// Index link file so the search is a bit faster
-bool topology_search::index_link_file(ArgumentParser& user_args, std::unordered_map<int, std::streampos>& index_table){
+    if (user_args.args.count("--compress") == 0){
+        user_args.args.insert({"--compress", "none"});
+    }
+    if (user_args.args["--compress"] != "none" && user_args.args["--compress"] != "bgzf"){
+        std::cout << "[topology_search::check_args][ERROR] --compress must be none or bgzf\n";
+        return false;
+    }
 
-    std::ifstream link_file(user_args.args["--graph"]);
-    int bin_size {std::stoi(user_args.args["--index-bin-size"])};
+    if (user_args.args.count("--search") == 0){
+        user_args.args.insert({"--search", "single"});
+    }
+    if (user_args.args["--search"] != "single" && user_args.args["--search"] != "bidirectional"){
+        std::cout << "[topology_search::check_args][ERROR] --search must be single or bidirectional\n";
+        return false;
+    }
 
-    char line_type;
-    std::string line_info;
+    if (user_args.args.count("--component-prepass") == 0){
+        user_args.args.insert({"--component-prepass", "no"});
+    }
+    if (user_args.args["--component-prepass"] != "no" && user_args.args["--component-prepass"] != "yes"){
+        std::cout << "[topology_search::check_args][ERROR] --component-prepass must be yes or no\n";
+        return false;
+    }
 
-    // jump to the area of the file with the 
-    bool reached_links {false};
-    while(!reached_links){
-        char next = link_file.peek();
-        if (next != 'L'){
-            link_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        }else{
-            reached_links = true;
-        }
+    if (user_args.args.count("--prune-masked") == 0){
+        user_args.args.insert({"--prune-masked", "no"});
+    }
+    if (user_args.args["--prune-masked"] != "no" && user_args.args["--prune-masked"] != "yes"){
+        std::cout << "[topology_search::check_args][ERROR] --prune-masked must be yes or no\n";
+        return false;
     }
 
-    // record the file position of every kth unitig, where k is the --index-bin_size argument
-    while (link_file >> line_type){
-        link_file >> line_info;
-        int id {topology_search::utg_to_int(line_info)};
+    // MB of links held in memory while the graph cache is built; 0 builds the whole graph in memory
+    if (user_args.args.count("--link-memory") == 0){
+        user_args.args.insert({"--link-memory", "0"});
+    }
+    if (std::stoll(user_args.args["--link-memory"]) < 0){
+        std::cout << "[topology_search::check_args][ERROR] --link-memory must be at least 0\n";
+        return false;
+    }
+
+    // --shard i/N searches the i-th of N slices of the candidates, for colorSV merge to combine
+    size_t shard, num_shards;
+    if (user_args.args.count("--shard") > 0 && user_args.args["command"] != "call"){
+        std::cout << "[topology_search::check_args][ERROR] --shard is only supported by call\n";
+        return false;
+    }
+    if (user_args.args.count("--shard") > 0 && !parse_shard(user_args.args["--shard"], shard, num_shards)){
+        std::cout << "[topology_search::check_args][ERROR] --shard must be i/N with 1 <= i <= N (e.g., 2/8)\n";
+        return false;
+    }
+    if (merging && std::stoll(user_args.args["--shards"]) < 1){
+        std::cout << "[topology_search::check_args][ERROR] number of shards must be at least 1\n";
+        return false;
+    }
 
-        // check if this the kth unitig; if so, record the location
-        if (id % bin_size == 1){
-            index_table[id] = link_file.tellg();
+    return true;
+}
 
-            link_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            // skip past the lines with the same unitig so we don't record the same unitig again
-            while (link_file >> line_type){
-                link_file >> line_info;
-                int next_id {topology_search::utg_to_int(line_info)};
-                if (next_id == id){
-                    // still on the same unitig, so skip to next line
-                    link_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                }else{
-                    // on a new unitig, so can go back to original loop of checking unitig IDs
-                    break;
-                }
+/* Candidates are the unitigs with more than one primary alignment (tp:A:P) */
+bool topology_search::get_split_alignments(const PafStore& alignments, std::unordered_set<std::string>& candidates, StageMetrics& metrics){
+    metrics.bytes_read = alignments.file_size();
+    TextSpan type;
+    for (size_t query{0}; query < alignments.num_queries(); query++){
+        int p_count {0};
+        for (const uint32_t* it = alignments.query_records_begin(query); it != alignments.query_records_end(query); it++){
+            if (!alignments.find_tag(*it, "tp", type)){
+                std::cout << "[topology_search::get_split_alignments][ERROR] unexpected formatting when parsing tumor-only unitig alignment file; no tp tag in an alignment of " << alignments.query_name(query).str() << '\n';
+                return false;
             }
+            if (type.size == 1 && type.data[0] == 'P'){
+                p_count++;
+            }
+        }
+        if (p_count > 1){
+            candidates.insert(alignments.query_name(query).str());
         }
-        // this will technically mean we skip over the next line after a recorded unitig
-        // in practice, shouldn't matter because the recorded unitigs should not be consecutive
-        link_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     }
-
-    link_file.close();
+    metrics.add_count("alignments", alignments.num_records());
+    metrics.add_count("unitigs", alignments.num_queries());
+    metrics.add_count("candidates", candidates.size());
     return true;
 }
 
-// converts unitig ID to integer representation
-// e.g., utg000016l becomes 16
-int topology_search::utg_to_int(std::string& utg_id){
-    // trim the "utg" at the beginning and the "l" at the end
-    
-    return std::stoi(utg_id.substr(3, utg_id.length() - 4));
+/* Finds candidates whose primary alignments all lie within regions of the --filter file; every SV called from
+   them would be removed by the region filter, so they do not need to be searched */
+bool topology_search::find_masked_candidates(const PafStore& alignments, const RegionMask& mask, const std::unordered_set<std::string>& candidates, std::unordered_set<std::string>& masked){
+    TextSpan type;
+    for (auto candidate = candidates.begin(); candidate != candidates.end(); candidate++){
+        size_t query;
+        if (!alignments.find_query(*candidate, query)){
+            continue;
+        }
+        bool any_primary {false};
+        bool all_covered {true};
+        for (const uint32_t* it = alignments.query_records_begin(query); it != alignments.query_records_end(query) && all_covered; it++){
+            if (!alignments.find_tag(*it, "tp", type) || type.size != 1 || type.data[0] != 'P'){
+                continue;
+            }
+            any_primary = true;
+            all_covered = mask.covers(alignments.field(*it, 5), paf_store::parse_int(alignments.field(*it, 7)), paf_store::parse_int(alignments.field(*it, 8)));
+        }
+        if (any_primary && all_covered){
+            masked.insert(*candidate);
+        }
+    }
+    return true;
 }
 
-bool topology_search::get_split_alignments(ArgumentParser& user_args, std::unordered_set<std::string>& candidates){
-    // TODO: refactor alignment type parsing
-    std::ifstream in_file(user_args.args["-o"] + "/intermediate_output/tumor_only_unitigs_mapq_filtered.paf");
+namespace{
+    using topology_search::CandidateResult;
+    using topology_search::SearchOutcome;
+
+    const char* outcome_names[] {"keep", "remove", "masked", "not_in_graph", "error"};
+
+    std::string k_list_text(const std::vector<int>& ks){
+        std::string text;
+        for (auto it = ks.begin(); it != ks.end(); it++){
+            text += (text.empty() ? "" : ",") + std::to_string(*it);
+        }
+        return text;
+    }
+
+    /* Splits the candidates into num_shards shards of about the same search work and returns those of shard (counted from 0)
+       in candidate order. The work of a candidate is estimated by the size of its neighborhood two links deep; candidates are
+       handed out from the largest estimate down, each to the shard with the least work so far, so every shard computes the
+       same split */
+    std::vector<size_t> shard_candidates(const LinkGraph& graph, const std::vector<std::string>& candidate_list, const std::vector<uint32_t>& candidate_ids, const std::unordered_set<std::string>& masked_candidates, size_t shard, size_t num_shards){
+        std::vector<uint64_t> work(candidate_list.size(), 1);
+        for (size_t i{0}; i < candidate_list.size(); i++){
+            if (candidate_ids[i] == graph.num_nodes() || masked_candidates.count(candidate_list[i])){
+                continue;
+            }
+            for (const uint32_t* it = graph.neighbors_begin(candidate_ids[i]); it != graph.neighbors_end(candidate_ids[i]); it++){
+                work[i] += 1 + graph.degree(*it);
+            }
+        }
+        std::vector<size_t> order(candidate_list.size());
+        for (size_t i{0}; i < order.size(); i++){
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){
+            return work[a] > work[b];
+        });
+
+        // (work, shard) of every shard, least work first
+        std::priority_queue<std::pair<uint64_t, size_t>, std::vector<std::pair<uint64_t, size_t>>, std::greater<std::pair<uint64_t, size_t>>> loads;
+        for (size_t i{0}; i < num_shards; i++){
+            loads.push({0, i});
+        }
+        std::vector<size_t> assigned;
+        for (auto it = order.begin(); it != order.end(); it++){
+            std::pair<uint64_t, size_t> least {loads.top()};
+            loads.pop();
+            if (least.second == shard){
+                assigned.push_back(*it);
+            }
+            loads.push({least.first + work[*it], least.second});
+        }
+        std::sort(assigned.begin(), assigned.end());
+        return assigned;
+    }
+
+    void count_result(const CandidateResult& candidate, StageMetrics& metrics){
+        if (candidate.outcome == SearchOutcome::not_in_graph){
+            metrics.add_count("not_in_graph", 1);
+        }else if (candidate.outcome == SearchOutcome::masked){
+            metrics.add_count("masked", 1);
+        }else if (!candidate.decided_by_prepass){
+            metrics.add_count("searched", 1);
+            metrics.histogram("nodes_expanded").add(candidate.nodes_expanded);
+            metrics.histogram("neighbor_lookups").add(candidate.neighbor_lookups);
+        }
+    }
 
-    std::string prev_unitig;
-    std::string unitig_id;
-    std::string line_info;
+    /* Writes the removed unitigs of every k and the reconnection depths, and collects the kept candidates into result, going
+       through the candidates in order */
+    void write_results(ArgumentParser& user_args, const std::vector<std::string>& candidate_list, const std::vector<CandidateResult>& results, std::unordered_map<std::string, size_t>& result, StageMetrics& metrics){
+        // a sweep over several k values writes one list of removed unitigs per k, and the depth at which each candidate's neighbors reconnect
+        std::vector<int> ks {topology_search::k_values(user_args)};
+        bool sweep {ks.size() > 1};
+        std::vector<std::ofstream> removed_files;
+        for (auto it = ks.begin(); it != ks.end(); it++){
+            std::string suffix {sweep ? ".k" + std::to_string(*it) : ""};
+            removed_files.emplace_back(user_args.args["-o"] + "/intermediate_output/removed_unitigs_topology_search" + suffix + ".txt");
+        }
+        std::ofstream depth_file;
+        if (sweep){
+            depth_file.open(user_args.args["-o"] + "/intermediate_output/reconnection_depth.txt");
+        }
 
-    int p_count {0};
+        for (size_t i{0}; i < candidate_list.size(); i++){
+            const CandidateResult& candidate {results[i]};
+            count_result(candidate, metrics);
+            if (candidate.outcome == SearchOutcome::not_in_graph){
+                continue;
+            }
+            // masked candidates are logged with the removed ones for every k, but never searched
+            for (size_t j{candidate.kept_ks}; j < ks.size(); j++){
+                removed_files[j] << candidate_list[i] << '\n';
+            }
+            if (candidate.kept_ks > 0){
+                result.insert({candidate_list[i], candidate.kept_ks});
+            }
+            if (sweep && candidate.outcome != SearchOutcome::masked){
+                depth_file << candidate_list[i] << '\t' << (candidate.depth < 0 ? "." : std::to_string(candidate.depth)) << '\n';
+            }
+        }
+        metrics.add_count("candidates", candidate_list.size());
+        metrics.add_count("passed", result.size());
+    }
 
-    // get the first unitig id and alignment type
-    in_file >> prev_unitig;
+    // 64-bit FNV-1a of the candidate names in order, so merge can tell whether shards worked on the same candidate list
+    uint64_t candidate_list_hash(const std::vector<std::string>& candidate_list){
+        uint64_t hash {14695981039346656037ULL};
+        for (auto it = candidate_list.begin(); it != candidate_list.end(); it++){
+            for (auto c = it->begin(); c != it->end(); c++){
+                hash = (hash ^ static_cast<unsigned char>(*c)) * 1099511628211ULL;
+            }
+            hash = (hash ^ '\n') * 1099511628211ULL;
+        }
+        return hash;
+    }
 
-    // skip to the tp tag
-    // since alignment is run internally, in_file format will always be the same
-    for (int i{0}; i < 16; i++){
-        in_file >> line_info;
+    /* The first line of a shard file is "#shard", the shard (counted from 1), the number of shards, the -k values, the number
+       of candidates of the whole call, a hash of their names in order and whether the component pre-pass ran; every other line is the result of one candidate
+       of the shard: its index in candidate order, name, outcome, kept_ks, depth, whether the pre-pass decided it, and the
+       nodes expanded and neighbor lookups of its searches */
+    bool write_shard(const std::string& path, size_t shard, size_t num_shards, const std::string& k_list, bool use_prepass, const std::vector<std::string>& candidate_list, const std::vector<size_t>& shard_list, const std::vector<CandidateResult>& results){
+        // write to a temporary file first so that merge never reads a shard that is still being written
+        std::string tmp_path {path + ".tmp"};
+        std::ofstream out(tmp_path);
+        out << "#shard\t" << shard + 1 << '\t' << num_shards << '\t' << k_list << '\t' << candidate_list.size() << '\t' << candidate_list_hash(candidate_list) << '\t' << use_prepass << '\n';
+        for (auto it = shard_list.begin(); it != shard_list.end(); it++){
+            const CandidateResult& candidate {results[*it]};
+            out << *it << '\t' << candidate_list[*it] << '\t' << outcome_names[static_cast<int>(candidate.outcome)] << '\t' << candidate.kept_ks << '\t' << candidate.depth << '\t';
+            out << candidate.decided_by_prepass << '\t' << candidate.nodes_expanded << '\t' << candidate.neighbor_lookups << '\n';
+        }
+        out.close();
+        if (out.fail()){
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        return std::rename(tmp_path.c_str(), path.c_str()) == 0;
     }
 
-    // double check we're on the right tag
-    if (line_info.substr(0, 2) != "tp"){
-        std::cout << "[topology_search::get_split_alignments][ERROR] unexpected formatting when parsing tumor-only unitig alignment file; expected tp field but got " << line_info.substr(0, 2) << "\n";
+    bool parse_outcome(const std::string& name, SearchOutcome& outcome){
+        for (int i{0}; i < static_cast<int>(SearchOutcome::error); i++){
+            if (name == outcome_names[i]){
+                outcome = static_cast<SearchOutcome>(i);
+                return true;
+            }
+        }
         return false;
     }
-    if (line_info.back() == 'P'){
-        p_count += 1;
+}
+
+/* Runs the topology search on every candidate; all tumor-only unitigs (all_tumor_utgs, indexed by node ID) are excluded from it.
+   With --shard i/N, only the candidates of shard i are searched, and their results are saved for colorSV merge instead */
+bool topology_search::run_topology_search(ArgumentParser& user_args, LinkGraph& graph, const std::vector<bool>& all_tumor_utgs, std::unordered_set<std::string>& candidates, const std::unordered_set<std::string>& masked_candidates, std::unordered_map<std::string, size_t>& result, StageMetrics& metrics){
+    std::vector<int> ks {k_values(user_args)};
+    size_t shard {0};
+    size_t num_shards {1};
+    bool sharded {user_args.args.count("--shard") > 0 && parse_shard(user_args.args["--shard"], shard, num_shards)};
+
+    SearchMode mode {user_args.args["--search"] == "bidirectional" ? SearchMode::bidirectional : SearchMode::single};
+    bool use_prepass {user_args.args["--component-prepass"] == "yes"};
+    if ((mode == SearchMode::bidirectional || use_prepass) && !graph.is_symmetric()){
+        std::cout << "[topology_search::run_topology_search] graph links are not symmetric, using single-source search without component pre-pass\n";
+        mode = SearchMode::single;
+        use_prepass = false;
+    }
+    unsigned num_threads {static_cast<unsigned>(std::stoi(user_args.args["-t"]))};
+
+    // fix the order of the candidates so that output does not depend on the number of threads, and sort them by name so that
+    // it does not depend on the hash set either: shards on other machines or builds must agree on every candidate's index
+    // candidates that are not in the graph keep an ID past the last node and are skipped by the search
+    std::vector<std::string> candidate_list(candidates.begin(), candidates.end());
+    std::sort(candidate_list.begin(), candidate_list.end());
+    std::vector<uint32_t> candidate_ids(candidate_list.size(), graph.num_nodes());
+    std::vector<bool> is_candidate(graph.num_nodes(), false);
+    for (size_t i{0}; i < candidate_list.size(); i++){
+        if (graph.get_id(candidate_list[i], candidate_ids[i])){
+            is_candidate[candidate_ids[i]] = true;
+        }
+    }
+
+    // the candidates searched here; is_candidate still marks every candidate, since searches must not pass through any of them
+    std::vector<size_t> search_list;
+    if (sharded){
+        search_list = shard_candidates(graph, candidate_list, candidate_ids, masked_candidates, shard, num_shards);
+        std::cout << "[topology_search::run_topology_search] searching " << search_list.size() << '/' << candidate_list.size() << " candidates in shard " << shard + 1 << '/' << num_shards << '\n';
+    }else{
+        search_list.resize(candidate_list.size());
+        for (size_t i{0}; i < search_list.size(); i++){
+            search_list[i] = i;
+        }
+    }
+
+    // candidates whose neighbors end up in different connected components without them are kept without a search
+    std::vector<uint32_t> components;
+    if (use_prepass){
+        components = free_components(graph, is_candidate, all_tumor_utgs);
     }
-    in_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
-    // iterate over lines in the paf file
-    while(in_file >> unitig_id){
-        if (unitig_id != prev_unitig){
-            // new block of unitigs, so check if previous unitig had a split alignment
-            if (p_count > 1){
-                candidates.insert(prev_unitig);
+    // outcomes are those of the largest k; a candidate is kept for the first kept_ks k values and removed for the rest
+    std::vector<CandidateResult> results(candidate_list.size(), CandidateResult{SearchOutcome::error, 0, -1, false, 0, 0});
+    std::vector<SearchWorkspace> workspaces(num_threads);
+    int cand_idx = 0;
+
+    // run topology search on every candidate, spread across the worker threads
+    // outcomes are checked on this thread in candidate order as they become available
+    bool success = run_in_order(search_list.size(), num_threads, [&](unsigned worker_id, size_t n){
+        size_t i {search_list[n]};
+        CandidateResult& candidate {results[i]};
+        if (candidate_ids[i] == graph.num_nodes()){
+            candidate.outcome = SearchOutcome::not_in_graph;
+        }else if (masked_candidates.count(candidate_list[i])){
+            candidate.outcome = SearchOutcome::masked;
+        }else if (use_prepass && neighbors_disconnected(candidate_ids[i], graph, components, is_candidate, all_tumor_utgs, workspaces[worker_id])){
+            candidate.outcome = SearchOutcome::keep;
+            candidate.kept_ks = ks.size();
+            candidate.decided_by_prepass = true;
+        }else{
+            // a search up to the largest k finds the depth at which the neighbors reconnect, which decides every smaller k as well
+            SearchWorkspace& workspace {workspaces[worker_id]};
+            candidate.outcome = search_candidate(candidate_ids[i], graph, is_candidate, all_tumor_utgs, ks.back(), mode, workspace);
+            candidate.nodes_expanded = workspace.nodes_expanded;
+            candidate.neighbor_lookups = workspace.neighbor_lookups;
+            candidate.kept_ks = ks.size();
+            if (candidate.outcome == SearchOutcome::remove){
+                candidate.depth = workspace.removal_depth;
+                candidate.kept_ks = static_cast<size_t>(std::lower_bound(ks.begin(), ks.end(), candidate.depth) - ks.begin());
             }
+        }
+    }, [&](size_t n){
+        if (results[search_list[n]].outcome == SearchOutcome::error){
+            return false;
+        }
+        cand_idx += 1;
+        if (cand_idx % 50 == 0){
+            std::cout << "[topology_search::run_topology_search] " << cand_idx << '/' << search_list.size() << " candidates checked\n";
+        }
+        return true;
+    });
 
-            // reset for next utg block
-            prev_unitig = unitig_id;
-            p_count = 0;
+    if (!success){
+        std::cout << "[topology_search::run_topology_search][ERROR] unitig reached during topology search has no links in graph file\n";
+        return false;
+    }
+
+    if (sharded){
+        std::string path {shard_path(user_args, shard, num_shards)};
+        if (!write_shard(path, shard, num_shards, k_list_text(ks), use_prepass, candidate_list, search_list, results)){
+            std::cout << "[topology_search::run_topology_search][ERROR] could not write shard results to " << path << '\n';
+            return false;
         }
-        // check alignment type
-        for (int i{0}; i < 16; i++){
-            in_file >> line_info;
+        for (auto it = search_list.begin(); it != search_list.end(); it++){
+            count_result(results[*it], metrics);
         }
+        metrics.add_count("candidates", candidate_list.size());
+        metrics.add_count("shard_candidates", search_list.size());
+    }else{
+        write_results(user_args, candidate_list, results, result, metrics);
+    }
+    if (use_prepass){
+        size_t num_decided {0};
+        for (auto it = search_list.begin(); it != search_list.end(); it++){
+            num_decided += results[*it].decided_by_prepass;
+        }
+        metrics.add_count("decided_by_prepass", num_decided);
+        std::cout << "[topology_search::run_topology_search] component pre-pass kept " << num_decided << '/' << search_list.size() << " candidates without a search\n";
+    }
+    return true;
+}
 
-        // double check we're on the right tag
-        if (line_info.substr(0, 2) != "tp"){
-            std::cout << "[topology_search::get_split_alignments][ERROR] unexpected formatting when parsing tumor-only unitig alignment file\n";
-            std::cout << unitig_id << '\n';
+/* Reads the results saved by the N shards of a call (--shards N) and writes the outputs a call without shards would write
+   from them; the shards must have been run on the same inputs and -k values */
+bool topology_search::merge_shards(ArgumentParser& user_args, std::unordered_map<std::string, size_t>& result, StageMetrics& metrics){
+    size_t num_shards {static_cast<size_t>(std::stoul(user_args.args["--shards"]))};
+    std::string k_list {k_list_text(k_values(user_args))};
+    std::vector<std::string> candidate_list;
+    std::vector<CandidateResult> results;
+    std::vector<char> merged;
+    uint64_t list_hash {0};
+    bool use_prepass {false};
+    for (size_t shard{0}; shard < num_shards; shard++){
+        std::string path {shard_path(user_args, shard, num_shards)};
+        std::ifstream in(path);
+        if (!in.is_open()){
+            std::cout << "[topology_search::merge_shards][ERROR] could not open results of shard " << shard + 1 << '/' << num_shards << ": " << path << '\n';
+            return false;
+        }
+        metrics.bytes_read += run_metrics::file_size(path);
+
+        std::string line;
+        std::getline(in, line);
+        std::istringstream header(line);
+        std::string tag, shard_k_list;
+        size_t header_shard, header_num_shards, num_candidates;
+        uint64_t shard_list_hash;
+        bool shard_prepass;
+        if (!(header >> tag >> header_shard >> header_num_shards >> shard_k_list >> num_candidates >> shard_list_hash >> shard_prepass) || tag != "#shard" || header_shard != shard + 1 || header_num_shards != num_shards){
+            std::cout << "[topology_search::merge_shards][ERROR] " << path << " does not hold the results of shard " << shard + 1 << '/' << num_shards << '\n';
             return false;
         }
-        if (line_info.back() == 'P'){
-            p_count += 1;
+        if (shard_k_list != k_list){
+            std::cout << "[topology_search::merge_shards][ERROR] shard " << shard + 1 << '/' << num_shards << " was searched with -k " << shard_k_list << ", not " << k_list << '\n';
+            return false;
+        }
+        if (shard == 0){
+            candidate_list.resize(num_candidates);
+            results.assign(num_candidates, CandidateResult{SearchOutcome::error, 0, -1, false, 0, 0});
+            merged.assign(num_candidates, 0);
+            list_hash = shard_list_hash;
+            use_prepass = shard_prepass;
+        }else if (num_candidates != candidate_list.size() || shard_list_hash != list_hash || shard_prepass != use_prepass){
+            std::cout << "[topology_search::merge_shards][ERROR] shards 1/" << num_shards << " and " << shard + 1 << '/' << num_shards << " were run on different candidates or options\n";
+            return false;
         }
-        in_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+        while (std::getline(in, line)){
+            std::istringstream fields(line);
+            size_t i;
+            std::string name, outcome;
+            CandidateResult candidate {SearchOutcome::error, 0, -1, false, 0, 0};
+            if (!(fields >> i >> name >> outcome >> candidate.kept_ks >> candidate.depth >> candidate.decided_by_prepass >> candidate.nodes_expanded >> candidate.neighbor_lookups) || i >= candidate_list.size() || merged[i] || !parse_outcome(outcome, candidate.outcome)){
+                std::cout << "[topology_search::merge_shards][ERROR] invalid or repeated candidate in " << path << ": " << line << '\n';
+                return false;
+            }
+            candidate_list[i] = name;
+            results[i] = candidate;
+            merged[i] = 1;
+        }
+    }
+
+    size_t num_missing {static_cast<size_t>(std::count(merged.begin(), merged.end(), 0))};
+    if (num_missing > 0){
+        std::cout << "[topology_search::merge_shards][ERROR] " << num_missing << '/' << candidate_list.size() << " candidates are in none of the " << num_shards << " shards; were all shards run on the same inputs?\n";
+        return false;
+    }
+    // every shard saw the same names at the same indices only if the merged names are in the order the shards sorted them
+    // into, without repeats, and hash like the list each shard started from
+    for (size_t i{1}; i < candidate_list.size(); i++){
+        if (candidate_list[i - 1] >= candidate_list[i]){
+            std::cout << "[topology_search::merge_shards][ERROR] shards disagree on the candidate list: " << candidate_list[i] << (candidate_list[i - 1] == candidate_list[i] ? " appears twice" : " is out of order") << '\n';
+            return false;
+        }
+    }
+    if (candidate_list_hash(candidate_list) != list_hash){
+        std::cout << "[topology_search::merge_shards][ERROR] shards disagree on the names of the candidates\n";
+        return false;
     }
+    write_results(user_args, candidate_list, results, result, metrics);
+    if (use_prepass){
+        size_t num_decided {0};
+        for (auto it = results.begin(); it != results.end(); it++){
+            num_decided += it->decided_by_prepass;
+        }
+        metrics.add_count("decided_by_prepass", num_decided);
+    }
+    metrics.add_count("shards", num_shards);
     return true;
 }
 
-bool topology_search::run_topology_search(ArgumentParser& user_args, std::unordered_map<int, std::streampos>& index_table, std::unordered_set<std::string>& candidates, std::unordered_set<std::string>& result){
-    // get set of all tumor-only unitigs, since they will be excluded from the topology search
-    std::string utg_path {user_args.args["-o"] + "/intermediate_output/all_tumor_only_unitigs.txt"};
-    std::unordered_set<std::string> all_tumor_utgs = load_tumor_unitigs(utg_path);
+/* --shard i/N, with the shard counted from 1; shard is returned counted from 0 */
+bool topology_search::parse_shard(const std::string& text, size_t& shard, size_t& num_shards){
+    size_t slash {text.find('/')};
+    if (slash == std::string::npos || slash == 0 || slash + 1 == text.size()){
+        return false;
+    }
+    char* shard_end {nullptr};
+    char* count_end {nullptr};
+    long long value {std::strtoll(text.c_str(), &shard_end, 10)};
+    long long count {std::strtoll(text.c_str() + slash + 1, &count_end, 10)};
+    if (shard_end != text.c_str() + slash || *count_end != '\0' || value < 1 || value > count){
+        return false;
+    }
+    shard = static_cast<size_t>(value - 1);
+    num_shards = static_cast<size_t>(count);
+    return true;
+}
 
-    std::ofstream removed_file(user_args.args["-o"] + "/intermediate_output/removed_unitigs_topology_search.txt");
+std::string topology_search::shard_path(ArgumentParser& user_args, size_t shard, size_t num_shards){
+    return user_args.args["-o"] + "/intermediate_output/topology_search_shard_" + std::to_string(shard + 1) + "_of_" + std::to_string(num_shards) + ".txt";
+}
 
-    int max_steps {std::stoi(user_args.args["-k"])};
-    int bin_size {std::stoi(user_args.args["--index-bin-size"])};
-    std::ifstream link_file(user_args.args["--graph"]);
+// The -k values in increasing order, without duplicates
+std::vector<int> topology_search::k_values(ArgumentParser& user_args){
+    std::vector<int> values;
+    std::istringstream k_list(user_args.args["-k"]);
+    std::string value;
+    while (std::getline(k_list, value, ',')){
+        values.push_back(std::stoi(value));
+    }
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    return values;
+}
 
-    // run topology search on every candidate by iterating through the set
-    std::unordered_set<std::string>::iterator itr;
-    int cand_idx = 0;
-    for (itr = candidates.begin(); itr != candidates.end(); itr++){
-        std::string target_utg {*itr};
-        bool to_remove {false};
-
-        // track the target unitig's neighbors, since we want to check if they can reach each other without the target
-        std::unordered_set<std::string> target_neighbors;
-        if (!get_neighbors(target_utg, link_file, target_neighbors, bin_size, index_table)){
-            // this unitig is not in link file, so we will mark as false positive 
-            continue;
-        }
+void topology_search::SearchWorkspace::begin_search(uint32_t num_nodes){
+    if (visit_stamps.size() != num_nodes){
+        visit_stamps.assign(num_nodes, 0);
+        epoch = 0;
+    }
+    epoch++;
+    // stamps from 2^32 searches ago would look current again, so clear them when the epoch wraps around
+    if (epoch == 0){
+        std::fill(visit_stamps.begin(), visit_stamps.end(), 0);
+        epoch = 1;
+    }
+    frontier.clear();
+}
 
-        // check for the special case where all neighbors are neighbors of each other
-        // if they are, then we should not mark this is a false positive
-        // so then we can skip the topology search
-        if (!direct_neighbors_check(target_neighbors, link_file, bin_size, index_table)){
-            // mark all candidates as "seen" because we only want to see if paths between neighbors exist without any candidate unitigs
-            std::unordered_set<std::string> seen_nodes;
-            std::unordered_set<std::string> seen_target_neighbors;
-            seen_nodes.insert(candidates.begin(), candidates.end());
-
-            // run BFS for k steps from one neighbor and see if we can get to all of the other neighbors
-            std::string start_node {*target_neighbors.begin()};
-            target_neighbors.erase(start_node);
-            seen_nodes.insert(start_node);
-
-            std::queue<std::string> to_traverse;
-            // start traveling at a random neighbor
-            to_traverse.push(start_node);
-            // use '*' to separate search layers (so we can keep track of distance)
-            to_traverse.push("*");
-
-            int steps_taken {0};
-            while (steps_taken <= max_steps){
-                // get next node to explore
-                std::string node {to_traverse.front()};
-                to_traverse.pop();
-
-                if (node == "*"){
-                    // we've reached the end of one search layer
-                    steps_taken++;
-                    to_traverse.push("*");
-                }else{
-                    // get current node's neighbors
-                    std::unordered_set<std::string> curr_neighbors;
-                    if (!get_neighbors(node, link_file, curr_neighbors, bin_size, index_table)){
-                        return false;
-                    }
-                
-                    // add current node's neighbors to queue if they haven't already been explored
-                    std::unordered_set<std::string>::iterator itr3;
-                    for (itr3 = curr_neighbors.begin(); itr3 != curr_neighbors.end(); itr3++){
-                        std::string neigh{*itr3};
-                        if(target_neighbors.count(neigh)){
-                            seen_target_neighbors.insert(neigh);
-                            if (seen_target_neighbors.size() == target_neighbors.size()){
+bool topology_search::SearchWorkspace::visited(uint32_t node) const{
+    return visit_stamps[node] == epoch;
+}
+
+void topology_search::SearchWorkspace::visit(uint32_t node){
+    visit_stamps[node] = epoch;
+    frontier.push_back(node);
+}
+
+void topology_search::SearchWorkspace::begin_bidirectional_search(uint32_t num_nodes){
+    begin_search(num_nodes);
+    if (source_bits.size() != num_nodes){
+        source_bits.assign(num_nodes, 0);
+        pending_bits.assign(num_nodes, 0);
+        frontier_bits.assign(num_nodes, 0);
+    }
+}
+
+uint64_t topology_search::SearchWorkspace::reached_by(uint32_t node) const{
+    return visited(node) ? source_bits[node] : 0;
+}
+
+void topology_search::SearchWorkspace::set_reached_by(uint32_t node, uint64_t sources){
+    visit_stamps[node] = epoch;
+    source_bits[node] = sources;
+}
+
+namespace{
+    using topology_search::SearchOutcome;
+    using topology_search::SearchWorkspace;
+
+    // BFS for up to k steps from start_node, until every other neighbor of the target (workspace.target_neighbors) has been seen
+    SearchOutcome single_source_search(uint32_t start_node, const LinkGraph& graph, const std::vector<bool>& is_candidate, const std::vector<bool>& all_tumor_utgs, int max_steps, SearchWorkspace& workspace){
+        const std::vector<uint32_t>& target_neighbors {workspace.target_neighbors};
+        std::vector<char>& seen_target_neighbors {workspace.seen_target_neighbors};
+        seen_target_neighbors.assign(target_neighbors.size(), 0);
+        size_t num_seen_target_neighbors {0};
+
+        // candidates are never traversed because we only want to see if paths between neighbors exist without any candidate unitigs
+        workspace.begin_search(graph.num_nodes());
+        workspace.visit(start_node);
+
+        // the nodes of the current layer are frontier[layer_begin, layer_end); the next layer is appended behind them
+        size_t layer_begin {0};
+        for (int steps_taken{0}; steps_taken <= max_steps && layer_begin < workspace.frontier.size(); steps_taken++){
+            size_t layer_end {workspace.frontier.size()};
+            graph.prefetch_neighbors(workspace.frontier.data() + layer_begin, workspace.frontier.data() + layer_end, workspace.prefetch_ranges);
+            for (size_t i{layer_begin}; i < layer_end; i++){
+                uint32_t node {workspace.frontier[i]};
+                if (graph.degree(node) == 0){
+                    return SearchOutcome::error;
+                }
+                workspace.nodes_expanded++;
+                workspace.neighbor_lookups++;
+
+                // add current node's neighbors to the next layer if they haven't already been explored
+                for (const uint32_t* it = graph.neighbors_begin(node); it != graph.neighbors_end(node); it++){
+                    uint32_t neigh {*it};
+                    auto target_pos = std::lower_bound(target_neighbors.begin(), target_neighbors.end(), neigh);
+                    if (target_pos != target_neighbors.end() && *target_pos == neigh){
+                        // target neighbors are traversed even if they are tumor-only unitigs, but only from where they are first seen
+                        size_t target_idx {static_cast<size_t>(target_pos - target_neighbors.begin())};
+                        if (!seen_target_neighbors[target_idx]){
+                            seen_target_neighbors[target_idx] = 1;
+                            num_seen_target_neighbors++;
+                            if (num_seen_target_neighbors == target_neighbors.size()){
                                 // successfully found a local path without candidate utgs
                                 // so mark as a false positive
-                                to_remove = true;
-                                break;
+                                workspace.removal_depth = steps_taken;
+                                return SearchOutcome::remove;
                             }
-                            to_traverse.push(neigh);
-                            seen_nodes.insert(neigh);
+                            workspace.visit(neigh);
                         }
+                        continue;
+                    }
+
+                    // ignore non-candidate tumor-only unitigs
+                    if (!all_tumor_utgs[neigh] && !is_candidate[neigh] && !workspace.visited(neigh)){
+                        workspace.visit(neigh);
+                    }
+                }
+            }
+            layer_begin = layer_end;
+        }
+        return SearchOutcome::keep;
+    }
 
-                        // ignore non-candidate tumor-only unitigs
-                        if (!all_tumor_utgs.count(neigh) && !seen_nodes.count(neigh)){
-                            to_traverse.push(neigh);
-                            seen_nodes.insert(neigh);
+    /* Same decision as single_source_search, but grows a ball around the start node and around every other neighbor of the
+       target in lockstep, with one bit per ball in each node's mask. A neighbor is within K = k + 1 steps of the start exactly
+       when its ball of radius floor(K / 2) meets the start's ball of radius ceil(K / 2), so no ball grows past about K / 2.
+       Neighbors are only joined to the start, never to each other: merging balls transitively would accept neighbors that
+       are up to 2K steps from the start through another neighbor, which the single-source search does not.
+       Links are followed backwards from the neighbors, so the graph must be symmetric; at most 63 neighbors fit in the mask.
+       A neighbor whose ball first meets the start's ball in layer r is 2r - 1 steps from the start if one of the two balls
+       already held the meeting node before that layer, and 2r steps if both reached it in that layer, which gives the
+       same removal depth as the single-source search */
+    SearchOutcome bidirectional_search(uint32_t start_node, const LinkGraph& graph, const std::vector<bool>& is_candidate, const std::vector<bool>& all_tumor_utgs, int max_steps, SearchWorkspace& workspace){
+        const std::vector<uint32_t>& target_neighbors {workspace.target_neighbors};
+        if (target_neighbors.empty()){
+            return SearchOutcome::keep;
+        }
+        const uint64_t start_bit {1};
+        const uint64_t all_target_bits {((uint64_t{1} << target_neighbors.size()) - 1) << 1};
+        const int total_steps {max_steps + 1};
+        const int start_radius {(total_steps + 1) / 2};
+        const int target_radius {total_steps / 2};
+
+        workspace.begin_bidirectional_search(graph.num_nodes());
+        std::vector<uint32_t>& frontier {workspace.frontier};
+        std::vector<uint64_t>& pending_bits {workspace.pending_bits};
+        std::vector<uint64_t>& frontier_bits {workspace.frontier_bits};
+        frontier.push_back(start_node);
+        workspace.set_reached_by(start_node, start_bit);
+        frontier_bits[start_node] = start_bit;
+        for (size_t i{0}; i < target_neighbors.size(); i++){
+            frontier.push_back(target_neighbors[i]);
+            workspace.set_reached_by(target_neighbors[i], uint64_t{2} << i);
+            frontier_bits[target_neighbors[i]] = uint64_t{2} << i;
+        }
+
+        // neighbors whose ball has met the start's ball, and those that met it at a node reached before the current layer
+        uint64_t joined {0};
+        uint64_t joined_early {0};
+        SearchOutcome outcome {SearchOutcome::keep};
+        size_t layer_begin {0};
+        for (int radius{1}; radius <= start_radius && layer_begin < frontier.size() && outcome == SearchOutcome::keep; radius++){
+            // balls of joined neighbors stop growing, as do all neighbor balls once they reach their radius
+            uint64_t growing {start_bit | (radius <= target_radius ? all_target_bits & ~joined : 0)};
+            uint64_t joined_before {joined};
+            size_t layer_end {frontier.size()};
+            graph.prefetch_neighbors(frontier.data() + layer_begin, frontier.data() + layer_end, workspace.prefetch_ranges);
+            for (size_t i{layer_begin}; i < layer_end && outcome == SearchOutcome::keep; i++){
+                uint32_t node {frontier[i]};
+                uint64_t sources {frontier_bits[node] & growing};
+                if (sources == 0){
+                    continue;
+                }
+                if (graph.degree(node) == 0){
+                    outcome = SearchOutcome::error;
+                    break;
+                }
+                workspace.nodes_expanded++;
+                workspace.neighbor_lookups++;
+
+                for (const uint32_t* it = graph.neighbors_begin(node); it != graph.neighbors_end(node); it++){
+                    uint32_t neigh {*it};
+                    uint64_t reached {workspace.reached_by(neigh)};
+                    uint64_t new_sources {sources & ~reached};
+                    if (new_sources == 0){
+                        continue;
+                    }
+                    // only non-candidate, non-tumor unitigs are entered, besides the neighbors themselves (which start out reached)
+                    if (reached == 0 && (all_tumor_utgs[neigh] || is_candidate[neigh])){
+                        continue;
+                    }
+                    reached |= new_sources;
+                    workspace.set_reached_by(neigh, reached);
+                    if (pending_bits[neigh] == 0){
+                        frontier.push_back(neigh);
+                    }
+                    pending_bits[neigh] |= new_sources;
+
+                    if (reached & start_bit){
+                        uint64_t met {reached & all_target_bits};
+                        joined |= met;
+                        joined_early |= (pending_bits[neigh] & start_bit) ? met & ~pending_bits[neigh] : met;
+                        // the rest of the layer can only matter for neighbors that have not yet met the start's ball early
+                        if (joined == all_target_bits && (joined & ~joined_before & ~joined_early) == 0){
+                            outcome = SearchOutcome::remove;
+                            break;
                         }
                     }
                 }
             }
+            if (outcome != SearchOutcome::error && joined == all_target_bits){
+                // the neighbors that joined last are the furthest from the start
+                outcome = SearchOutcome::remove;
+                workspace.removal_depth = 2 * radius - ((joined & ~joined_before & ~joined_early) == 0 ? 1 : 0) - 1;
+            }
+
+            // the sources that reached each node of the next layer are the ones it passes on
+            for (size_t i{layer_end}; i < frontier.size(); i++){
+                frontier_bits[frontier[i]] = pending_bits[frontier[i]];
+                pending_bits[frontier[i]] = 0;
+            }
+            layer_begin = layer_end;
         }
+        return outcome;
+    }
+}
 
-        if (to_remove){
-            removed_file << target_utg << '\n';
-        }else{
-            result.insert(target_utg);
+// Checks whether the neighbors of one candidate unitig can still reach each other within k steps without any candidate or tumor-only unitigs
+topology_search::SearchOutcome topology_search::search_candidate(uint32_t target_utg, const LinkGraph& graph, const std::vector<bool>& is_candidate, const std::vector<bool>& all_tumor_utgs, int max_steps, SearchMode mode, SearchWorkspace& workspace){
+    workspace.nodes_expanded = 0;
+    workspace.neighbor_lookups = 0;
+    workspace.removal_depth = -1;
+
+    // track the target unitig's neighbors, since we want to check if they can reach each other without the target
+    if (graph.degree(target_utg) == 0){
+        // this unitig is not in link file, so we will mark as false positive 
+        return SearchOutcome::not_in_graph;
+    }
+    std::vector<uint32_t>& target_neighbors {workspace.target_neighbors};
+    target_neighbors.assign(graph.neighbors_begin(target_utg), graph.neighbors_end(target_utg));
+    workspace.neighbor_lookups += 1 + target_neighbors.size();
+
+    // check for the special case where all neighbors are neighbors of each other
+    // if they are, then we should not mark this is a false positive
+    // so then we can skip the topology search
+    if (direct_neighbors_check(target_neighbors, graph, workspace.neighbor_buffer)){
+        return SearchOutcome::keep;
+    }
+
+    // run BFS for k steps from one neighbor and see if we can get to all of the other neighbors
+    // the search starts at the first neighbor listed in the graph file
+    uint32_t start_node {target_neighbors.front()};
+    target_neighbors.erase(target_neighbors.begin());
+    std::sort(target_neighbors.begin(), target_neighbors.end());
+
+    if (mode == SearchMode::bidirectional && target_neighbors.size() < 64){
+        return bidirectional_search(start_node, graph, is_candidate, all_tumor_utgs, max_steps, workspace);
+    }
+    return single_source_search(start_node, graph, is_candidate, all_tumor_utgs, max_steps, workspace);
+}
+
+/* Labels the connected components of the graph restricted to unitigs the search may enter (no candidates or tumor-only
+   unitigs) with union-find; other unitigs get the label num_nodes */
+std::vector<uint32_t> topology_search::free_components(const LinkGraph& graph, const std::vector<bool>& is_candidate, const std::vector<bool>& all_tumor_utgs){
+    std::vector<uint32_t> parent(graph.num_nodes());
+    std::vector<uint32_t> size(graph.num_nodes(), 1);
+    for (uint32_t id{0}; id < graph.num_nodes(); id++){
+        parent[id] = id;
+    }
+    auto find = [&](uint32_t id){
+        while (parent[id] != id){
+            parent[id] = parent[parent[id]];
+            id = parent[id];
         }
-        cand_idx += 1;
-        if (cand_idx % 50 == 0){
-            std::cout << "[topology_search::run_topology_search] " << cand_idx << '/' << candidates.size() << " candidates checked\n";
+        return id;
+    };
+
+    for (uint32_t id{0}; id < graph.num_nodes(); id++){
+        if (all_tumor_utgs[id] || is_candidate[id]){
+            continue;
+        }
+        for (const uint32_t* it = graph.neighbors_begin(id); it != graph.neighbors_end(id); it++){
+            if (all_tumor_utgs[*it] || is_candidate[*it]){
+                continue;
+            }
+            uint32_t a {find(id)};
+            uint32_t b {find(*it)};
+            if (a == b){
+                continue;
+            }
+            if (size[a] < size[b]){
+                std::swap(a, b);
+            }
+            parent[b] = a;
+            size[a] += size[b];
         }
     }
-    return true;
+
+    for (uint32_t id{0}; id < graph.num_nodes(); id++){
+        parent[id] = (all_tumor_utgs[id] || is_candidate[id]) ? graph.num_nodes() : find(id);
+    }
+    return parent;
 }
 
-bool topology_search::get_neighbors(std::string& target_utg, std::ifstream& link_file, std::unordered_set<std::string>& neighbor_list, int bin_size, std::unordered_map<int, std::streampos>& index_table){
-    std::string link_info;
-    int utg_int_id {utg_to_int(target_utg)};
-
-    // round current utg ID down to the beginning of the current bin to get lookup index
-    int link_index {((utg_int_id - 1)/bin_size)*bin_size + 1};
-
-    // unitigs are occasionally removed from the link file
-    // if the lookup unitig for the section that we're trying to check is missing, then move the index back until we find a unitig that hasn't been removed
-    while (index_table.find(link_index) == index_table.end() && link_index - bin_size >= 1) {
-        link_index -= bin_size;
-    }
-    assert(index_table.find(link_index) != index_table.end());
-
-    // jump to unitig location in link file
-    link_file.seekg(index_table[link_index], std::ios::beg);
-
-    // sometimes unitigs are not reported in link file
-    // need to track this, since candidate unitigs not in link files should be marked as a false positive
-    bool found_utg {false};
-
-    // special case for the first unitig in a bin because of how the file was indexed
-    // link table will point to position AFTER the first unitig name
-    // i.e., if your first line in the bin is:
-    //           L  utg1    +   utg901 ........
-    // then the first character read from the line will be '+'
-    // so this statement checks if our current unitig is the beginning of the bin
-    if (utg_int_id % bin_size == 1){
-        found_utg = true;
-        link_file >> link_info;
-        link_file >> link_info;
-        neighbor_list.insert(link_info);
-    }
-    link_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-    while(link_file >> link_info){
-        // next character is unitig ID
-        link_file >> link_info;
-        if (found_utg && link_info != target_utg){
-            // if we've already seen the target unitig, but the next unitig we're checking doesn't match, then that means we've added all neighbors
-            break;
-        }
-        if (link_info == target_utg){
-            found_utg = true;
-            // found the right unitig, so add this neighbor
-            link_file >> link_info;
-            link_file >> link_info;
-            neighbor_list.insert(link_info);
-        }
-        link_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    }
-    // reset failbit to prevent bug after reaching EOF
-    if (link_file.fail()){
-        auto state = std::cin.rdstate();
-        state &= ~std::ios_base::failbit;
-        link_file.clear(state);
-    }
-    return found_utg;
+/* True if the neighbors of the target cannot reach each other at any distance without it, in which case the search would
+   keep the target for every k. Neighbors the search may not otherwise enter (tumor-only unitigs) are still traversed by it,
+   so they join the components of their own neighbors. Assumes links are listed in both directions */
+bool topology_search::neighbors_disconnected(uint32_t target_utg, const LinkGraph& graph, const std::vector<uint32_t>& components, const std::vector<bool>& is_candidate, const std::vector<bool>& all_tumor_utgs, SearchWorkspace& workspace){
+    std::vector<uint32_t>& sources {workspace.target_neighbors};
+    sources.assign(graph.neighbors_begin(target_utg), graph.neighbors_end(target_utg));
+    if (sources.size() < 2){
+        return false;
+    }
+    std::sort(sources.begin(), sources.end());
+
+    std::vector<uint32_t>& parent {workspace.source_parent};
+    parent.resize(sources.size());
+    for (uint32_t i{0}; i < parent.size(); i++){
+        parent[i] = i;
+    }
+    auto find = [&](uint32_t i){
+        while (parent[i] != i){
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+
+    // collect the components each neighbor belongs to, and join neighbors that are linked to each other directly
+    std::vector<uint64_t>& component_sources {workspace.component_sources};
+    component_sources.clear();
+    for (uint32_t i{0}; i < sources.size(); i++){
+        uint32_t source {sources[i]};
+        if (!all_tumor_utgs[source] && !is_candidate[source]){
+            component_sources.push_back(uint64_t{components[source]} << 32 | i);
+            continue;
+        }
+        for (const uint32_t* it = graph.neighbors_begin(source); it != graph.neighbors_end(source); it++){
+            if (!all_tumor_utgs[*it] && !is_candidate[*it]){
+                component_sources.push_back(uint64_t{components[*it]} << 32 | i);
+                continue;
+            }
+            auto other = std::lower_bound(sources.begin(), sources.end(), *it);
+            if (other != sources.end() && *other == *it){
+                parent[find(i)] = find(static_cast<uint32_t>(other - sources.begin()));
+            }
+        }
+    }
+
+    // neighbors sharing a component are connected
+    std::sort(component_sources.begin(), component_sources.end());
+    for (size_t i{1}; i < component_sources.size(); i++){
+        if (component_sources[i] >> 32 == component_sources[i - 1] >> 32){
+            parent[find(static_cast<uint32_t>(component_sources[i]))] = find(static_cast<uint32_t>(component_sources[i - 1]));
+        }
+    }
+
+    uint32_t root {find(0)};
+    for (uint32_t i{1}; i < sources.size(); i++){
+        if (find(i) != root){
+            return true;
+        }
+    }
+    return false;
 }
 
-bool topology_search::write_final_paf(ArgumentParser& args, std::unordered_set<std::string>& sv_set){
-    std::ifstream orig_paf(args.args["-o"] + "/intermediate_output/tumor_only_unitigs_mapq_filtered.paf");
+/* Copies the alignments of the unitigs that passed the search; their records are looked up in the index and written in
+   file order, with runs of adjacent records copied at once */
+bool topology_search::write_final_paf(ArgumentParser& args, const PafStore& alignments, const std::unordered_map<std::string, size_t>& sv_set, StageMetrics& metrics){
     std::ofstream new_paf(args.args["-o"] + "/intermediate_output/candidate_svs_without_mask.paf");
 
-    std::string line;
-    while (std::getline(orig_paf, line)){
-        std::istringstream iss(line);
-        std::string id;
-        iss >> id;
-        // copy old PAF line to new file if it belongs to a candidate unitig
-        if (sv_set.count(id)){
-            new_paf << line << '\n';
+    std::vector<uint32_t> records;
+    for (auto it = sv_set.begin(); it != sv_set.end(); it++){
+        size_t query;
+        if (alignments.find_query(it->first, query)){
+            records.insert(records.end(), alignments.query_records_begin(query), alignments.query_records_end(query));
         }
     }
+    std::sort(records.begin(), records.end());
+    alignments.write_records(records, new_paf);
+    new_paf.close();
+    if (!new_paf){
+        std::cout << "[topology_search::write_final_paf][ERROR] could not write candidate alignments to " << args.args["-o"] << "/intermediate_output/candidate_svs_without_mask.paf\n";
+        return false;
+    }
+    metrics.add_count("alignments", alignments.num_records());
+    metrics.add_count("alignments_written", records.size());
     return true;
 }
 
-bool topology_search::direct_neighbors_check(std::unordered_set<std::string>& to_check, std::ifstream& link_file, int bin_size, std::unordered_map<int, std::streampos>& index_table){
-    std::unordered_set<std::string> all_neighbors;
-    std::unordered_set<std::string>::iterator itr;
-
+bool topology_search::direct_neighbors_check(const std::vector<uint32_t>& to_check, const LinkGraph& graph, std::vector<uint32_t>& all_neighbors){
     // get the set of all neighbors' neighbors
-    for (itr = to_check.begin(); itr != to_check.end(); itr++){
-        std::string neigh {*itr};
-        // add this unitig's neighbors to the set of all neighbors
-        std::unordered_set<std::string> curr_neighbors;
-        get_neighbors(neigh, link_file, curr_neighbors, bin_size, index_table);
-
-        all_neighbors.insert(curr_neighbors.begin(), curr_neighbors.end());
+    all_neighbors.clear();
+    for (auto it = to_check.begin(); it != to_check.end(); it++){
+        all_neighbors.insert(all_neighbors.end(), graph.neighbors_begin(*it), graph.neighbors_end(*it));
     }
+    std::sort(all_neighbors.begin(), all_neighbors.end());
 
     // check if all of the original neighbors are in the set of neighbors' neighbors
-    bool direct_neighbors {true};
-    for (itr = to_check.begin(); itr != to_check.end(); itr++){
-        std::string curr_utg {*itr};
-        if (!all_neighbors.count(curr_utg)){
-            direct_neighbors = false;
-            break;
+    for (auto it = to_check.begin(); it != to_check.end(); it++){
+        if (!std::binary_search(all_neighbors.begin(), all_neighbors.end(), *it)){
+            return false;
         }
     }
-    return direct_neighbors;
+    return true;
 }
 
-std::unordered_set<std::string> topology_search::load_tumor_unitigs(std::string& utg_path){
-    std::unordered_set<std::string> result;
+// Marks every tumor-only unitig listed in the file; unitigs that are not in the graph are ignored
+std::vector<bool> topology_search::load_tumor_unitigs(std::string& utg_path, const LinkGraph& graph){
+    std::vector<bool> result(graph.num_nodes(), false);
     std::ifstream utg_file(utg_path);
     std::string curr_utg;
+    uint32_t utg_id;
     while(utg_file >> curr_utg){
-        result.insert(curr_utg);
+        if (graph.get_id(curr_utg, utg_id)){
+            result[utg_id] = true;
+        }
     }
     return result;
 }
@@ -1,23 +1,93 @@
 #ifndef TOPOLOGY_SEARCH_H
 #define TOPOLOGY_SEARCH_H
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "argument_parser.h"
+#include "link_graph.h"
+#include "paf_store.h"
+#include "region_mask.h"
+#include "run_metrics.h"
 
 namespace topology_search{
+	enum class SearchOutcome {keep, remove, masked, not_in_graph, error};
+	// single grows one BFS from the first neighbor of a candidate; bidirectional grows one from every neighbor at once
+	enum class SearchMode {single, bidirectional};
+
+	// search result of one candidate: its outcome for the largest k, the number of k values (smallest first) it is kept for,
+	// the depth at which its neighbors reconnect (-1 if they do not within the largest k) and the work its searches did
+	struct CandidateResult{
+		SearchOutcome outcome;
+		size_t kept_ks;
+		int depth;
+		bool decided_by_prepass;
+		size_t nodes_expanded;
+		size_t neighbor_lookups;
+	};
+
+	// Buffers reused by every search of one worker thread, so that a search allocates nothing once they have grown
+	// nodes count as visited when their stamp equals the epoch of the current search, so starting a search is O(1)
+	struct SearchWorkspace{
+		SearchWorkspace() : visit_stamps(), epoch(0), frontier(), target_neighbors(), seen_target_neighbors(), neighbor_buffer(), source_bits(), pending_bits(), frontier_bits(), nodes_expanded(0), neighbor_lookups(0), removal_depth(-1), component_sources(), source_parent(), prefetch_ranges(){}
+
+		// starts a new search over a graph with num_nodes nodes
+		void begin_search(uint32_t num_nodes);
+		bool visited(uint32_t node) const;
+		void visit(uint32_t node);
+		// bidirectional searches also track which sources have reached each visited node
+		void begin_bidirectional_search(uint32_t num_nodes);
+		uint64_t reached_by(uint32_t node) const;
+		void set_reached_by(uint32_t node, uint64_t sources);
+
+		std::vector<uint32_t> visit_stamps;
+		uint32_t epoch;
+		// nodes in the order they are reached; each search layer is a contiguous range
+		std::vector<uint32_t> frontier;
+		std::vector<uint32_t> target_neighbors;
+		std::vector<char> seen_target_neighbors;
+		std::vector<uint32_t> neighbor_buffer;
+		// one bit per source; frontier_bits holds the sources a node was reached by in the last layer and
+		// pending_bits those of the layer being built (all zero between searches)
+		std::vector<uint64_t> source_bits;
+		std::vector<uint64_t> pending_bits;
+		std::vector<uint64_t> frontier_bits;
+		// number of nodes whose neighbors were scanned by the last search, and of all neighbor lists it read (including those
+		// of the candidate and its neighbors)
+		size_t nodes_expanded;
+		size_t neighbor_lookups;
+		// smallest k at which the last search would remove its candidate, if it did; -1 otherwise
+		int removal_depth;
+		// (component, neighbor) pairs and a union-find over the neighbors for neighbors_disconnected
+		std::vector<uint64_t> component_sources;
+		std::vector<uint32_t> source_parent;
+		// byte ranges of the neighbor lists of a layer, for LinkGraph::prefetch_neighbors
+		std::vector<std::pair<uint64_t, uint64_t>> prefetch_ranges;
+	};
+
 	bool check_args(ArgumentParser& user_args);
-	bool index_link_file(ArgumentParser& user_args, std::unordered_map<int, std::streampos>& index_table);
-	int utg_to_int(std::string& utg_id);
-	bool get_split_alignments(ArgumentParser& user_args, std::unordered_set<std::string>& candidates);
-	bool run_topology_search(ArgumentParser& user_args, std::unordered_map<int, std::streampos>& index_table, std::unordered_set<std::string>& candidates, std::unordered_set<std::string>& result);
-	bool get_neighbors(std::string& target_utg, std::ifstream& link_file, std::unordered_set<std::string>& neighbor_list, int bin_size, std::unordered_map<int, std::streampos>& index_table);
-
-	bool write_final_paf(ArgumentParser& args, std::unordered_set<std::string>& sv_set);
-	bool direct_neighbors_check(std::unordered_set<std::string>& to_check, std::ifstream& link_file, int bin_size, std::unordered_map<int, std::streampos>& index_table);
-	std::unordered_set<std::string> load_tumor_unitigs(std::string& utg_path);
+	bool get_split_alignments(const PafStore& alignments, std::unordered_set<std::string>& candidates, StageMetrics& metrics);
+	bool find_masked_candidates(const PafStore& alignments, const RegionMask& mask, const std::unordered_set<std::string>& candidates, std::unordered_set<std::string>& masked);
+	// result maps every candidate that passes the search for the smallest k to the number of k values (smallest first) it passes for;
+	// with --shard, the results of the shard's candidates are saved to shard_path and result is left empty
+	bool run_topology_search(ArgumentParser& user_args, LinkGraph& graph, const std::vector<bool>& all_tumor_utgs, std::unordered_set<std::string>& candidates, const std::unordered_set<std::string>& masked_candidates, std::unordered_map<std::string, size_t>& result, StageMetrics& metrics);
+	std::vector<int> k_values(ArgumentParser& user_args);
+	SearchOutcome search_candidate(uint32_t target_utg, const LinkGraph& graph, const std::vector<bool>& is_candidate, const std::vector<bool>& all_tumor_utgs, int max_steps, SearchMode mode, SearchWorkspace& workspace);
+
+	// combines the results saved by the shards of a call (--shard) into the outputs of run_topology_search
+	bool merge_shards(ArgumentParser& user_args, std::unordered_map<std::string, size_t>& result, StageMetrics& metrics);
+	bool parse_shard(const std::string& text, size_t& shard, size_t& num_shards);
+	std::string shard_path(ArgumentParser& user_args, size_t shard, size_t num_shards);
+
+	std::vector<uint32_t> free_components(const LinkGraph& graph, const std::vector<bool>& is_candidate, const std::vector<bool>& all_tumor_utgs);
+	bool neighbors_disconnected(uint32_t target_utg, const LinkGraph& graph, const std::vector<uint32_t>& components, const std::vector<bool>& is_candidate, const std::vector<bool>& all_tumor_utgs, SearchWorkspace& workspace);
+
+	bool write_final_paf(ArgumentParser& args, const PafStore& alignments, const std::unordered_map<std::string, size_t>& sv_set, StageMetrics& metrics);
+	bool direct_neighbors_check(const std::vector<uint32_t>& to_check, const LinkGraph& graph, std::vector<uint32_t>& all_neighbors);
+	std::vector<bool> load_tumor_unitigs(std::string& utg_path, const LinkGraph& graph);
 }
 
 #endif